@@ -5,7 +5,8 @@
  *
  * This version uses a single instance to talk to multiple one wire devices.
  * During configuration the devices will be listed and the addresses
- * then stored within the system  they are associated with.
+ * then stored within the system  they are associated with. Each instance
+ * keeps its own registry of devices, so several buses can be used at once.
  *
  * Then previously stored addresses are used to query devices.
  *
@@ -42,6 +43,12 @@
 
 #endif
 
+#include "one_wire_crc.h"
+#include "one_wire_pio.h"
+#include "one_wire_registry.h"
+#include "one_wire_slots.h"
+#include "one_wire_stats.h"
+
 #define FAMILY_CODE address.rom[0]
 #define FAMILY_CODE_DS18S20 0x10 //9bit temp
 #define FAMILY_CODE_DS18B20 0x28 //9-12bit temp also known as MAX31820
@@ -58,42 +65,116 @@ static const int ConvertTempCommand = 0x44;
 static const int MatchROMCommand = 0x55;
 static const int ReadROMCommand = 0x33;
 static const int SearchROMCommand = 0xF0;
+static const int AlarmSearchCommand = 0xEC;
 static const int SkipROMCommand = 0xCC;
+static const int OverdriveSkipROMCommand = 0x3C;
+static const int OverdriveMatchROMCommand = 0x69;
 static const int WriteScratchPadCommand = 0x4E;
-static const int ROMSize = 8;
-struct rom_address_t {
-	uint8_t rom[ROMSize];
+static const int CopyScratchPadCommand = 0x48;
+static const int ScratchPadSize = 9;
+
+/**
+ * Result of a bus transaction
+ */
+enum class one_wire_status_t {
+	ok,
+	no_presence,       // nothing answered the reset
+	crc_error,         // the data read back failed its CRC
+	unsupported_device // the family does not have that function
 };
 
 /**
- * OneWire with DS1820 Dallas 1-Wire Temperature Probe
+ * Progress of a ROM search, lets a search be resumed one device at a time
+ * (see One_wire::search_begin and One_wire::search_next)
+ */
+struct search_state_t {
+	uint8_t rom[ROMSize];  // the last address found, or the family seed
+	int last_discrepancy;  // bit where the next pass takes the 1 branch, 0 when done
+	bool last_device;      // no devices left to find
+	uint8_t command;       // SearchROMCommand or AlarmSearchCommand
+	uint8_t family;        // only find devices of this family, 0 for any
+	bool no_presence;      // nothing answered the reset of the last pass
+};
+
+/**
+ * Results of a whole bus read, as parallel arrays supplied by the caller
+ * (see Bus_readings for fixed size storage). Entry i of each array describes
+ * the same device.
+ */
+struct bus_readings_t {
+	uint64_t *ids;        // device ID as returned by One_wire::to_uint64
+	int16_t *raw;         // temperature register, 1/16 degC (1/2 degC for DS18S20)
+	bool *crc_ok;         // false if the scratch pad failed its CRC (or a fast read was implausible)
+	uint64_t *timestamps; // time_us_64 when the scratch pad was read
+	size_t capacity;
+	size_t count;
+};
+
+/**
+ * Storage for the readings of up to Capacity devices
+ */
+template<size_t Capacity>
+struct Bus_readings : bus_readings_t {
+	Bus_readings() : bus_readings_t{_ids, _raw, _crc_ok, _timestamps, Capacity, 0} {}
+
+	Bus_readings(const Bus_readings &) = delete;
+	Bus_readings &operator=(const Bus_readings &) = delete;
+
+private:
+	uint64_t _ids[Capacity]{};
+	int16_t _raw[Capacity]{};
+	bool _crc_ok[Capacity]{};
+	uint64_t _timestamps[Capacity]{};
+};
+
+/**
+ * Devices that joined or left the bus, as arrays supplied by the caller (see
+ * Bus_changes for fixed size storage)
+ */
+struct bus_changes_t {
+	rom_address_t *added;
+	rom_address_t *removed;
+	size_t capacity;     // size of each of added and removed, further changes are not listed
+	size_t added_count;
+	size_t removed_count;
+};
+
+/**
+ * Storage for up to Capacity additions and Capacity removals
+ */
+template<size_t Capacity>
+struct Bus_changes : bus_changes_t {
+	Bus_changes() : bus_changes_t{_added, _removed, Capacity, 0, 0} {}
+
+	Bus_changes(const Bus_changes &) = delete;
+	Bus_changes &operator=(const Bus_changes &) = delete;
+
+private:
+	rom_address_t _added[Capacity]{};
+	rom_address_t _removed[Capacity]{};
+};
+
+/**
+ * A 1-Wire bus using a device registry supplied by its owner, so the registry
+ * can be sized for the bus. One_wire (below) brings its own registry of
+ * default_max_devices.
  *
- * Example:
  * @code
- * #include "one_wire.h"
- *
- * One_wire one_wire(15); //GP15 - Pin 20 on Pi Pico
- *
- * int main() {
- *     one_wire.init();
- *     rom_address_t address{};
- *     while (true) {
- *         one_wire.single_device_read_rom(address);
- *         one_wire.convert_temperature(address, true, true);
- *         printf("It is %3.1foC\n", one_wire.temperature(address));
- *         sleep_ms(1000);
- *     }
- * }
+ * Device_registry<64> registry;
+ * One_wire_base one_wire(registry, 15);
  * @endcode
  */
-class One_wire {
+class One_wire_base {
 public:
 	enum {
 		invalid_conversion = -1000,
+		conversion_not_started = -1,
 		not_controllable = 0xFFFFFFFF
 	};
 
-	/** Create a one wire bus object connected to the specified pins
+	static const size_t default_max_devices = 16;
+
+	/** Create a one wire bus object using a caller supplied device registry
 	 *
 	 * The bus might either by regular powered or parasite powered. If it is parasite
 	 * powered and power_pin is set, that pin will be used to switch an external mosfet
@@ -101,12 +182,14 @@ public:
 	 * regular data pin is used to supply extra power when required. This will be
 	 * sufficient as long as the number of devices is limited.
 	 *
+	 * @param registry storage for the devices found on this bus, a Device_registry<N>
+	 *        that lives as long as this object
 	 * @param data_pin pin for the data bus
 	 * @param power_pin (optional) pin to control the power MOSFET
 	 * @param power_polarity (optional) which sets active state (false for active low (default), true for active high)
 	 */
-	One_wire(uint data_pin, uint power_pin = not_controllable, bool power_polarity = false);
-	~One_wire();
+	One_wire_base(Device_registry_base &registry, uint data_pin, uint power_pin = not_controllable, bool power_polarity = false);
+	~One_wire_base();
 
 	/**
 	 * Initialise and determine if any devices are using parasitic power
@@ -114,7 +197,17 @@ public:
 	void init();
 
 	/**
-	 * Finds all one wire devices and returns the count
+	 * Run the bus on a PIO state machine instead of bit-banging the data pin,
+	 * call after init(). Reset, bit and byte transfers are then timed by the PIO.
+	 *
+	 * @param pio the PIO block to use (pio0 or pio1)
+	 * @return true if a state machine was claimed, otherwise the bus stays bit-banged
+	 */
+	bool use_pio(PIO pio);
+
+	/**
+	 * Finds all one wire devices and returns the count, the registry is cleared
+	 * and refilled with the devices found
 	 *
 	 * @return - number of devices found
 	 */
@@ -126,20 +219,80 @@ public:
 	 * @param index the index into found devices
 	 * @return the address of
 	 */
-	static rom_address_t &get_address(int index);
+	rom_address_t &get_address(int index);
+
+	/**
+	 * @return the number of devices in this bus's registry
+	 */
+	[[nodiscard]] int device_count() const;
+
+	/**
+	 * Look up the registry entry of a device
+	 *
+	 * @param address the device address
+	 * @return the entry, or nullptr if the device has not been found or used on this bus
+	 */
+	device_info_t *find_device(rom_address_t &address);
 
 	/**
 	 * This routine will initiate the temperature conversion within
 	 * one or all temperature devices.
 	 *
 	 * @param wait if true or parasitic power is used, waits up to 750 ms for
-	 * conversion otherwise returns immediately.
+	 * conversion otherwise returns immediately. With conversion polling enabled
+	 * the wait ends as soon as the devices report completion.
 	 * @param address allows the function to apply to a specific device or
 	 * to all devices on the 1-Wire bus.
-	 * @returns milliseconds until conversion will complete.
+	 * @returns milliseconds until conversion will complete, or
+	 * conversion_not_started if no device answered the reset.
 	 */
 	int convert_temperature(rom_address_t &address, bool wait, bool all);
 
+	/**
+	 * Start a temperature conversion without waiting for it to complete, an
+	 * absolute deadline is recorded for the device (or the whole bus). An
+	 * address that is not in the registry is not added, its deadline is held
+	 * with the whole bus's.
+	 *
+	 * With parasite power the strong pull up is left on, no other bus traffic
+	 * should be attempted until conversion_ready() returns true.
+	 *
+	 * @param address the device to convert, ignored if all is set
+	 * @param all convert every device on the bus
+	 * @returns milliseconds until conversion will complete, or
+	 * conversion_not_started if no device answered the reset.
+	 */
+	int start_conversion(rom_address_t &address, bool all);
+
+	/**
+	 * Cheap check whether a conversion started by start_conversion() has completed,
+	 * does not touch the bus other than ending a parasite power strong pull up.
+	 *
+	 * @param address the device to check
+	 * @returns true once the conversion deadline has passed
+	 */
+	bool conversion_ready(rom_address_t &address);
+
+	/**
+	 * Read the result of a conversion started by start_conversion()
+	 *
+	 * @param address the device to read
+	 * @param temperature receives the temperature, untouched on failure
+	 * @param convert_to_fahrenheit whether to convert the degC to Fahrenheit
+	 * @returns false if the conversion is still running or a CRC error was detected
+	 */
+	bool collect_temperature(rom_address_t &address, float &temperature, bool convert_to_fahrenheit = false);
+
+	/**
+	 * Externally powered devices hold read slots low while converting, when
+	 * enabled conversion_ready() and convert_temperature() poll a read slot
+	 * instead of relying only on the datasheet worst case delay (which remains
+	 * the timeout). Ignored with parasite power where timed waits are always used.
+	 *
+	 * @param enable true to poll read slots for conversion complete
+	 */
+	void set_conversion_polling(bool enable);
+
 	/**
 	 * Changes the "endianness" of the unique device ID in supplied address
 	 * so that it can be conveniently printed out and manipulated as a number.
@@ -157,21 +310,314 @@ public:
 	 */
 	float temperature(rom_address_t &address, bool convert_to_fahrenheit = false);
 
+	/**
+	 * As temperature(), reporting why a read failed
+	 *
+	 * @param temperature set to the temperature for that scale, unchanged on failure
+	 * @returns ok, no_presence, crc_error or unsupported_device
+	 */
+	one_wire_status_t read_temperature(rom_address_t &address, float &temperature, bool convert_to_fahrenheit = false);
+
+	/**
+	 * As read_temperature(), in integer 1/16 degree units with no floating
+	 * point, for parts without an FPU. Every family's reading is exact at this
+	 * scale, including the DS18S20 extended resolution.
+	 *
+	 * @param sixteenths set to the temperature in 1/16 degC (or degF), unchanged on failure
+	 * @returns ok, no_presence, crc_error or unsupported_device
+	 */
+	one_wire_status_t read_temperature_fixed(rom_address_t &address, int32_t &sixteenths, bool convert_to_fahrenheit = false);
+
+	/**
+	 * Temperature in 1/16 degC from a scratch pad, as read_temperature_fixed()
+	 *
+	 * @param family family code of the device the scratch pad was read from
+	 */
+	static int32_t scratch_pad_to_fixed(uint8_t family, const uint8_t *scratch_pad);
+
+	/**
+	 * @returns 1/16 degC converted to 1/16 degF, rounded to nearest
+	 */
+	static int32_t fixed_to_fahrenheit(int32_t sixteenths);
+
+	/**
+	 * @returns 1/16 degree units converted to thousandths, rounded to nearest
+	 */
+	static int32_t fixed_to_milli(int32_t sixteenths);
+
+	/**
+	 * Convert and read every device in the registry in one pass. A single Skip ROM
+	 * conversion is waited for (as convert_temperature() with wait set), then each
+	 * device's scratch pad is read straight into the result arrays.
+	 *
+	 * @param readings arrays to fill, devices beyond its capacity are skipped
+	 * @returns the number of devices read
+	 */
+	int read_all(bus_readings_t &readings);
+
+	/**
+	 * As read_all(), for buses mixing resolutions. The devices are grouped by
+	 * their cached resolution and one Skip ROM conversion starts every group,
+	 * then each group is read as soon as its conversion time is up, fastest
+	 * first, so the fast devices are read while the slow ones are still
+	 * converting and the bus takes little more than the slowest conversion.
+	 * Resolutions and power modes are only read from devices that have not
+	 * had them cached yet (see read_device_config()).
+	 *
+	 * A parasite powered device needs the strong pull up, and so the bus to
+	 * itself, for its whole conversion. If any device is (or might be)
+	 * parasite powered the conversion is held for the slowest group's time
+	 * instead, followed by the reads.
+	 *
+	 * @param readings arrays to fill, devices beyond its capacity are skipped
+	 * @returns the number of devices read
+	 */
+	int read_all_staggered(bus_readings_t &readings);
+
+	/**
+	 * Fast reads clock in only the two temperature bytes of the scratch pad and then
+	 * reset the bus, a quarter of the bus time of a full read. Without the CRC they
+	 * are checked for plausibility instead: the value must be in the sensor range
+	 * and within max_step of the previous reading, otherwise a full CRC checked read
+	 * is made straight away. Every full_read_interval fast reads a full read is made
+	 * regardless. Applies to temperature() and read_all(), DS18S20s are always read
+	 * in full as they need COUNT_REMAIN.
+	 *
+	 * @param enable true to use fast reads
+	 * @param full_read_interval fast reads between full CRC checked reads
+	 * @param max_step largest plausible change between readings, in 1/16 degC
+	 */
+	void set_fast_read(bool enable, unsigned int full_read_interval = 16, unsigned int max_step = 5 * 16);
+
+	/**
+	 * Sets the alarm thresholds (TH and TL) of a temperature device, the device
+	 * alarm flag is set by a conversion that measures above high or below low.
+	 *
+	 * @param address the device to configure
+	 * @param high alarm when the temperature is above this, degC
+	 * @param low alarm when the temperature is below this, degC
+	 * @param persist also copy the thresholds to the device EEPROM so they survive a power cycle
+	 * @returns false for devices without alarms or if the scratch pad could not be read
+	 */
+	bool set_alarm_thresholds(rom_address_t &address, int8_t high, int8_t low, bool persist = false);
+
+	/**
+	 * Alarm Search, finds only the devices whose last conversion was outside
+	 * their thresholds. Does not change the device registry.
+	 *
+	 * @param addresses filled with the addresses of the alarmed devices
+	 * @param max_devices size of addresses
+	 * @returns the number of alarmed devices found
+	 */
+	int find_alarmed_devices(rom_address_t *addresses, int max_devices);
+
+	/**
+	 * Search only the branch of the ROM tree holding one family, the search
+	 * stops as soon as it passes the family instead of walking the whole bus.
+	 * Does not change the device registry.
+	 *
+	 * @param family family code, e.g. FAMILY_CODE_DS18B20
+	 * @param addresses filled with the addresses of the devices found
+	 * @param max_devices size of addresses, the search stops once this many are found
+	 * @returns the number of devices found
+	 */
+	int find_devices_of_family(uint8_t family, rom_address_t *addresses, int max_devices);
+
+	/**
+	 * Bring the device registry up to date without a full search when nothing
+	 * has changed. Each known device, of any family, is confirmed with a search
+	 * pass seeded with its address, a full search only runs if one of them has gone, if
+	 * something answers on a bus with no known devices, or every
+	 * set_full_search_interval rescans. Metadata of the devices still present is kept.
+	 *
+	 * @param changes filled with the devices added to and removed from the registry
+	 * @returns the number of devices now in the registry
+	 */
+	int rescan(bus_changes_t &changes);
+
+	/**
+	 * A device added alongside the known ones does not change what rescan
+	 * sees, a periodic full search finds it.
+	 *
+	 * @param rescans run a full search every this many rescans, 0 (default) only when the bus changes
+	 */
+	void set_full_search_interval(unsigned int rescans);
+
+	/**
+	 * Start a resumable search, pass the state to search_next to find each device
+	 *
+	 * @param search the state to initialise
+	 * @param family (optional) only find devices of this family, 0 (default) for all
+	 * @param command (optional) SearchROMCommand (default) or AlarmSearchCommand
+	 */
+	static void search_begin(search_state_t &search, uint8_t family = 0, uint8_t command = SearchROMCommand);
+
+	/**
+	 * Find the next device of a search, other bus commands may be issued
+	 * between calls as the search restarts from its saved state
+	 *
+	 * @param search state from search_begin
+	 * @param address filled with the device found
+	 * @returns false when there are no more devices (or the bus failed to reset)
+	 */
+	bool search_next(search_state_t &search, rom_address_t &address);
+
+	/**
+	 * Issue Overdrive Skip ROM, switching every overdrive capable device and the
+	 * bus to overdrive speed. Subsequent resets and commands run at overdrive speed
+	 * until a reset gets no answer, then the bus falls back to standard speed.
+	 * Only reliable on the PIO engine, see Overdrive_timing_profile.
+	 *
+	 * @returns true if any device answered the reset
+	 */
+	bool overdrive_skip_rom();
+
+	/**
+	 * Issue Overdrive Match ROM, switching the addressed device and the bus to
+	 * overdrive speed. The address itself is sent at overdrive speed.
+	 *
+	 * @param address the device to select
+	 * @returns true if any device answered the reset
+	 */
+	bool overdrive_match_rom(rom_address_t &address);
+
+	/*
+	 * Transaction API, for device specific commands: reset(), select() or
+	 * select_all() (or overdrive_skip_rom() / overdrive_match_rom()), then
+	 * write() and read() on buffers the caller owns. Whole buffers run in one
+	 * loop over the slots, or as one PIO block.
+	 */
+
+	/**
+	 * Reset pulse and presence detect
+	 *
+	 * @returns true if any device answered
+	 */
+	bool reset();
+
+	/**
+	 * Reset and Match ROM, the commands that follow go to this device only
+	 *
+	 * @param address the device to select
+	 * @returns true if any device answered the reset
+	 */
+	bool select(rom_address_t &address);
+
+	/**
+	 * Reset and Skip ROM, the commands that follow go to every device
+	 *
+	 * @returns true if any device answered the reset
+	 */
+	bool select_all();
+
+	/**
+	 * Write bytes to the bus, least significant bit first
+	 *
+	 * @param data bytes to write
+	 * @param length number of bytes
+	 */
+	void write(const uint8_t *data, size_t length);
+
+	/**
+	 * Read bytes from the bus
+	 *
+	 * @param data filled with the bytes read
+	 * @param length number of bytes
+	 */
+	void read(uint8_t *data, size_t length);
+
+	void write_byte(uint8_t data);
+
+	uint8_t read_byte();
+
+	void write_bit(bool bit);
+
+	bool read_bit();
+
+	/**
+	 * Wait for a device to finish an EEPROM write or a conversion, with the
+	 * strong pull up on if the bus is parasite powered
+	 *
+	 * @param ms time to wait
+	 */
+	void powered_wait(unsigned int ms);
+
+	/**
+	 * Select a device (or every device), write a command and read its answer
+	 *
+	 * @param address device to select, nullptr for Skip ROM
+	 * @param out bytes to write after selecting
+	 * @param out_length number of bytes to write
+	 * @param in (optional) filled with the bytes read after writing
+	 * @param in_length (optional) number of bytes to read
+	 * @returns ok, or no_presence if no device answered the reset
+	 */
+	one_wire_status_t transaction(rom_address_t *address, const uint8_t *out, size_t out_length, uint8_t *in = nullptr,
+								  size_t in_length = 0);
+
+	/**
+	 * Return to standard speed, the next reset is a standard speed reset which
+	 * also returns every device to standard speed
+	 */
+	void set_standard_speed();
+
+	/**
+	 * @returns true while the bus is running at overdrive speed
+	 */
+	[[nodiscard]] bool overdrive() const { return _timing == &overdrive_timing; }
+
+	static const slot_timing_t standard_timing;
+	static const slot_timing_t overdrive_timing;
+
+	/**
+	 * Bit-banged slots whose strict part ran late, e.g. held up by a flash
+	 * access or the other core, cleared by init. A rising count means the
+	 * reads that need retries are being disturbed rather than the cable.
+	 *
+	 * @returns the number of slots that overran their sample window
+	 */
+	[[nodiscard]] uint32_t slot_overruns() const { return _slot_overruns; }
+
 	/**
 	 * This function sets the temperature resolution for supported devices
-	 * in the configuration register.
+	 * in the configuration register. The alarm thresholds are written back
+	 * from the device's configuration cache, the scratch pad is only read the
+	 * first time a device is configured.
 	 *
 	 * @param resolution number between 9 and 12 to specify resolution
 	 * @returns true if successful
 	 */
 	bool set_resolution(rom_address_t &address, unsigned int resolution);
 
+	/**
+	 * Fill the configuration cache of a device (resolution, alarm thresholds and
+	 * power mode) so conversions wait only as long as its resolution needs.
+	 * Only what is not already cached is read, the cache is kept up to date by
+	 * set_resolution and set_alarm_thresholds.
+	 *
+	 * @param address the device to read
+	 * @returns false if the scratch pad failed its CRC or the registry is full
+	 */
+	bool read_device_config(rom_address_t &address);
+
 	/**
 	 * Assuming a single device is attached, do a Read ROM
 	 *
-	 * @param rom_address the address will be filled into this parameter
+	 * @param rom_address the address will be filled into this parameter, it is
+	 *        left unchanged unless the ROM code passes its CRC
+	 * @returns ok, no_presence, or crc_error after every retry
+	 */
+	one_wire_status_t single_device_read_rom(rom_address_t &rom_address);
+
+	/**
+	 * Repeat a transaction that failed its CRC or got no presence pulse. Only
+	 * the failed transaction is repeated, e.g. one device's scratch pad read
+	 * within read_all. Failures are counted per device in device_info_t.
+	 *
+	 * @param retries extra attempts, 0 (the default) to try once
+	 * @param retry_delay_us (optional) pause before each retry, to ride out a noise burst
 	 */
-	void single_device_read_rom(rom_address_t &rom_address);
+	void set_retry_policy(unsigned int retries, unsigned int retry_delay_us = 0);
 
 	/**
 	 * Static utility method for easy conversion from previously stored addresses
@@ -181,27 +627,59 @@ public:
 	 */
 	static rom_address_t address_from_hex(const char *hex_address);
 
+	/**
+	 * Counters and bus time since init or clear_stats, all zero unless the
+	 * library is built with ONE_WIRE_STATS=1
+	 */
+	[[nodiscard]] const bus_stats_t &stats() const { return _stats.stats(); }
+
+	void clear_stats() { _stats.clear(); }
+
 private:
+	friend class One_wire_async;// runs transactions on this bus from alarm callbacks
+
 	uint _data_pin;
 	uint _parasite_pin;
 	bool _parasite_power{};
 	bool _power_mosfet;
 	bool _power_polarity;
-	uint8_t _search_ROM[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-	uint8_t ram[9]{};
+	One_wire_pio _pio_engine;
+	const slot_timing_t *_timing{&standard_timing};
+	mutable uint32_t _slot_overruns{};
+	uint8_t ram[ScratchPadSize]{};
+
+	bool _strong_pullup{};
+	bool _poll_conversion{};
+	bool _conversion_on_bus{}; // Convert T was the last command, read slots report its progress
+	bool _conversion_on_bus_all{};
+	uint64_t _conversion_on_bus_id{};
+	uint64_t _bus_conversion_deadline{};
+	bool _fast_read{};
+	unsigned int _full_read_interval{16};
+	unsigned int _fast_read_max_step{5 * 16};
+	unsigned int _full_search_interval{};
+	unsigned int _rescans_since_search{};
+	unsigned int _retries{};
+	unsigned int _retry_delay_us{};
+
+	Device_registry_base &_devices;
+#if ONE_WIRE_STATS
+	mutable One_wire_stats _stats;
+#else
+	static inline One_wire_stats _stats;// empty, takes no space in each bus
+#endif
 
-	int _last_discrepancy;	// search state
-	bool _last_device;  // search state
+	static void bit_write(uint8_t &value, int bit, bool set);
 
-	static uint8_t crc_byte(uint8_t crc, uint8_t byte);
+	[[nodiscard]] bool reset_check_for_device();
 
-	static void bit_write(uint8_t &value, int bit, bool set);
+	[[nodiscard]] bool reset_pulse();
 
-	[[nodiscard]] bool reset_check_for_device() const;
+	void set_timing(const slot_timing_t &timing);
 
-	void match_rom(rom_address_t &address);
+	bool match_rom(rom_address_t &address);
 
-	void skip_rom();
+	bool skip_rom();
 
 	void onewire_bit_out(bool bit_data) const;
 
@@ -213,15 +691,83 @@ private:
 
 	static bool rom_checksum_error(uint8_t *address);
 
-	bool ram_checksum_error();
+	bool search_rom_find_next(search_state_t &search, rom_address_t &address);
 
-	bool search_rom_find_next();
+	bool device_present(rom_address_t &address);
+
+	void rescan_full_search(bus_changes_t &changes);
+
+	void copy_scratch_pad(rom_address_t &address);
 
 	void read_scratch_pad(rom_address_t &address);
 
-	void write_scratch_pad(rom_address_t &address, int data);
+	bool read_scratch_pad(rom_address_t &address, uint8_t *scratch_pad);
+
+	one_wire_status_t read_scratch_pad_checked(rom_address_t &address, uint8_t *scratch_pad);
+
+	one_wire_status_t read_temperature_scratch_pad(rom_address_t &address, uint8_t *scratch_pad);
+
+	[[nodiscard]] bool fast_read_plausible(device_info_t &device, int16_t raw) const;
+
+	void onewire_block_out(const uint8_t *data, size_t length);
+
+	void onewire_block_in(uint8_t *data, size_t length);
+
+	void write_scratch_pad(rom_address_t &address, uint8_t high, uint8_t low, uint8_t config);
+
+	device_info_t *configured_device(rom_address_t &address, device_info_t &uncached);
+
+	static int conversion_time(rom_address_t &address, const device_info_t *device);
 
 	bool power_supply_available(rom_address_t &address, bool all);
+
+	int conversion_delay(rom_address_t &address, bool all);
+
+	void strong_pullup(bool enable);
+
+	bool conversion_needs_pullup(rom_address_t &address, bool all);
+
+	bool conversion_polled_complete(uint64_t id);
+
+	void read_into(bus_readings_t &readings, size_t index);
+};
+
+/**
+ * OneWire with DS1820 Dallas 1-Wire Temperature Probe
+ *
+ * Example:
+ * @code
+ * #include "one_wire.h"
+ *
+ * One_wire one_wire(15); //GP15 - Pin 20 on Pi Pico
+ *
+ * int main() {
+ *     one_wire.init();
+ *     rom_address_t address{};
+ *     while (true) {
+ *         one_wire.single_device_read_rom(address);
+ *         one_wire.convert_temperature(address, true, true);
+ *         printf("It is %3.1foC\n", one_wire.temperature(address));
+ *         sleep_ms(1000);
+ *     }
+ * }
+ * @endcode
+ */
+class One_wire : public One_wire_base {
+public:
+	/** Create a one wire bus object connected to the specified pins, with a
+	 * registry of default_max_devices. For larger (or smaller) buses use
+	 * One_wire_base with a Device_registry<N>.
+	 *
+	 * @param data_pin pin for the data bus
+	 * @param power_pin (optional) pin to control the power MOSFET
+	 * @param power_polarity (optional) which sets active state (false for active low (default), true for active high)
+	 */
+	explicit One_wire(uint data_pin, uint power_pin = not_controllable, bool power_polarity = false)
+			: One_wire_base(_default_devices, data_pin, power_pin, power_polarity) {}
+
+private:
+	Device_registry<default_max_devices> _default_devices;// only bound by the base, not used until init
 };
 
 
@@ -0,0 +1,151 @@
+/*
+ * pico-pi-one-wire Library, alarm driven transactions
+ *
+ * Runs a whole bus read as a state machine advanced from hardware alarm
+ * callbacks, so the CPU is free during the reset pulses, the recovery time and
+ * the conversion. Only the bit slots themselves run in tight code.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_ASYNC_H
+#define PICO_PI_ONEWIRE_ASYNC_H
+
+#include <atomic>
+
+#include "one_wire.h"
+
+#ifdef MOCK_PICO_PI
+
+#include "../test/pico_pi_mocks.h"
+
+#else
+
+#include "pico/time.h"
+
+#endif
+
+/**
+ * Event driven read of every device on a bus
+ *
+ * Each transaction is a chain of states, a state does its bit slots then
+ * returns how long to wait before the next, and a hardware alarm brings it
+ * back. The bus object must not be used while a read is in progress.
+ *
+ * @code
+ * One_wire one_wire(15);
+ * One_wire_async async_bus(one_wire);
+ * Bus_readings<16> readings;
+ *
+ * one_wire.init();
+ * one_wire.find_and_count_devices_on_bus();
+ * async_bus.start_read_all(readings);
+ * while (async_bus.busy()) {
+ *     // other work, or __wfi()
+ * }
+ * @endcode
+ */
+class One_wire_async {
+public:
+	/**
+	 * Called from the alarm interrupt when a read completes, or from start_read_all
+	 * itself when the read completes without waiting (no device answered the PIO reset)
+	 */
+	typedef void (*done_callback_t)(bus_readings_t &readings, void *user_data);
+
+	explicit One_wire_async(One_wire_base &bus);
+
+	~One_wire_async();
+
+	/**
+	 * Start converting and reading every registered device, as One_wire::read_all
+	 * but returning straight away
+	 *
+	 * @param readings filled in as the devices are read, count is set once complete
+	 *        (0 if no device answered the reset)
+	 * @param done (optional) called once complete, see done_callback_t
+	 * @param user_data (optional) passed to done
+	 * @returns false if a read is already in progress or no alarm is free
+	 */
+	bool start_read_all(bus_readings_t &readings, done_callback_t done = nullptr, void *user_data = nullptr);
+
+	/**
+	 * @returns true until the read started by start_read_all completes
+	 */
+	[[nodiscard]] bool busy() const { return _busy.load(std::memory_order_acquire); }
+
+	/**
+	 * Abandon a read in progress, the bus is released
+	 */
+	void cancel();
+
+private:
+	enum class state_t {
+		idle,
+		reset_low,       // bus held low for the reset pulse
+		reset_release,   // let the bus float high
+		presence_sample, // sample presence, then the recovery time
+		convert,         // Skip ROM, Convert T
+		conversion_start,// power the conversion
+		conversion_done,
+		select_device,   // Match ROM, Read Scratch Pad of the next device
+		store_reading,
+		transfer         // one byte of _out then _in per alarm
+	};
+
+	// the bus is idle high between bytes, so the alarm can take any time to come back
+	static const uint32_t byte_gap_us = 1;
+	// how much before the presence sample the alarm is asked for, covers its latency
+	static const uint32_t presence_lead_us = 20;
+	static const size_t max_out = 1 + ROMSize + 1;
+
+	One_wire_base &_bus;
+	bus_readings_t *_readings{};
+	done_callback_t _done{};
+	void *_user_data{};
+	state_t _state{state_t::idle};
+	state_t _after_reset{state_t::idle};
+	state_t _after_transfer{state_t::idle};
+	uint32_t _released{};
+	bool _presence{};
+	size_t _device{};
+	size_t _count{};
+	uint8_t _out[max_out]{};
+	size_t _out_length{};
+	uint8_t _in[ScratchPadSize]{};
+	size_t _in_length{};
+	size_t _transferred{};
+	alarm_id_t _alarm{};
+	std::atomic<bool> _busy{false};
+
+	static int64_t alarm_callback(alarm_id_t id, void *user_data);
+
+	uint32_t advance();
+
+	uint32_t run_state();
+
+	void begin_reset(state_t next);
+
+	void begin_transfer(size_t out_length, size_t in_length, state_t next);
+
+	void finish(size_t count);
+};
+
+
+#endif// PICO_PI_ONEWIRE_ASYNC_H
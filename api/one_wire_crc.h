@@ -0,0 +1,119 @@
+/*
+ * pico-pi-one-wire Library, Dallas/Maxim CRC8 and CRC16
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_CRC_H
+#define PICO_PI_ONEWIRE_CRC_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Select the CRC implementation used by the library, define ONE_WIRE_CRC_IMPLEMENTATION
+ * as one of these in the build to override the default 256 entry tables.
+ *   bitwise - no tables, 8 shifts per byte
+ *   nibble  - 16 entry tables (16 bytes for CRC8, 32 for CRC16), 2 lookups per byte
+ *   table   - 256 entry tables (256 bytes for CRC8, 512 for CRC16), 1 lookup per byte
+ */
+#define ONE_WIRE_CRC_BITWISE 0
+#define ONE_WIRE_CRC_NIBBLE 1
+#define ONE_WIRE_CRC_TABLE 2
+
+#ifndef ONE_WIRE_CRC_IMPLEMENTATION
+#define ONE_WIRE_CRC_IMPLEMENTATION ONE_WIRE_CRC_TABLE
+#endif
+
+/**
+ * CRC8 (X^8 + X^5 + X^4 + 1) used for ROM codes and scratch pads, and CRC16
+ * (X^16 + X^15 + X^2 + 1) used by the memory devices, both shifted LSB first.
+ *
+ * Every implementation is always available so they can be compared, crc8()
+ * and crc16() use the one chosen by ONE_WIRE_CRC_IMPLEMENTATION.
+ */
+class One_wire_crc {
+public:
+	static uint8_t crc8_bitwise(uint8_t crc, uint8_t byte);
+
+	static uint8_t crc8_nibble(uint8_t crc, uint8_t byte);
+
+	static uint8_t crc8_table(uint8_t crc, uint8_t byte);
+
+	static uint16_t crc16_bitwise(uint16_t crc, uint8_t byte);
+
+	static uint16_t crc16_nibble(uint16_t crc, uint8_t byte);
+
+	static uint16_t crc16_table(uint16_t crc, uint8_t byte);
+
+	static inline uint8_t crc8_byte(uint8_t crc, uint8_t byte) {
+#if ONE_WIRE_CRC_IMPLEMENTATION == ONE_WIRE_CRC_TABLE
+		return crc8_table(crc, byte);
+#elif ONE_WIRE_CRC_IMPLEMENTATION == ONE_WIRE_CRC_NIBBLE
+		return crc8_nibble(crc, byte);
+#else
+		return crc8_bitwise(crc, byte);
+#endif
+	}
+
+	static inline uint16_t crc16_byte(uint16_t crc, uint8_t byte) {
+#if ONE_WIRE_CRC_IMPLEMENTATION == ONE_WIRE_CRC_TABLE
+		return crc16_table(crc, byte);
+#elif ONE_WIRE_CRC_IMPLEMENTATION == ONE_WIRE_CRC_NIBBLE
+		return crc16_nibble(crc, byte);
+#else
+		return crc16_bitwise(crc, byte);
+#endif
+	}
+
+	/**
+	 * CRC8 over a block
+	 *
+	 * @param data bytes to check
+	 * @param length number of bytes
+	 * @param crc starting value, allows a block to be checked in parts
+	 * @return the CRC, 0 if data ended with its own correct CRC
+	 */
+	static uint8_t crc8(const uint8_t *data, size_t length, uint8_t crc = 0);
+
+	/**
+	 * CRC16 over a block
+	 *
+	 * @param data bytes to check
+	 * @param length number of bytes
+	 * @param crc starting value, allows a block to be checked in parts
+	 * @return the CRC
+	 */
+	static uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc = 0);
+
+	/**
+	 * Check a block against the inverted CRC16 the devices send, LSB first,
+	 * after the data.
+	 *
+	 * @param data bytes covered by the CRC
+	 * @param length number of bytes
+	 * @param inverted_crc the two CRC bytes as read from the device
+	 * @param crc starting value, for example the CRC of the command and address bytes
+	 * @return true if the CRC matches
+	 */
+	static bool crc16_valid(const uint8_t *data, size_t length, const uint8_t *inverted_crc, uint16_t crc = 0);
+};
+
+
+#endif// PICO_PI_ONEWIRE_CRC_H
@@ -0,0 +1,237 @@
+/*
+ * pico-pi-one-wire Library, compile time specialised bus
+ *
+ * A bus whose pins and slot timings are template parameters, so each slot is
+ * a handful of SIO register writes with constant masks and constant delays,
+ * with no pin lookups or engine checks on the per-bit path.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_FIXED_H
+#define PICO_PI_ONEWIRE_FIXED_H
+
+#include "one_wire.h"
+
+/**
+ * A 1-Wire bus fixed at compile time
+ *
+ * Gives the transaction level of the bus only: resets, ROM commands, byte
+ * transfers, Read ROM and scratch pad reads. It is not a replacement for
+ * One_wire: there is no device search, find_and_count_devices_on_bus(),
+ * registry or temperature API, so the addresses have to be known (or read
+ * with read_rom() from a single device bus) and conversions timed by the
+ * caller. One_wire takes its pins at run time and shares the same slot
+ * sequences and timing profiles.
+ *
+ * @code
+ * One_wire_fixed<15> bus;
+ * uint8_t scratch_pad[ScratchPadSize];
+ *
+ * bus.init();
+ * bus.skip_rom();
+ * bus.byte_out(ConvertTempCommand);
+ * sleep_ms(750);
+ * if (bus.read_scratch_pad(address, scratch_pad) == one_wire_status_t::ok) {
+ *     int32_t sixteenths = One_wire::scratch_pad_to_fixed(address.rom[0], scratch_pad);
+ * }
+ * @endcode
+ *
+ * @tparam DataPin pin for the data bus
+ * @tparam PowerPin (optional) pin to control the power MOSFET
+ * @tparam Profile (optional) timing profile, Standard_timing_profile (default),
+ *         Overdrive_timing_profile or Long_line_timing_profile (overdrive is
+ *         bit-banged here, so not reliable, see Overdrive_timing_profile)
+ * @tparam PowerPolarity (optional) what to set the power pin to, to enable power
+ */
+template<uint DataPin, uint PowerPin = One_wire::not_controllable, typename Profile = Standard_timing_profile, bool PowerPolarity = false>
+class One_wire_fixed {
+public:
+	static_assert(DataPin < 30, "DataPin must be a GPIO number");
+
+	static constexpr const slot_timing_t &timing = Profile::timing;
+
+	/**
+	 * Initialise the pins, the bus is left released
+	 */
+	void init() {
+		gpio_init(DataPin);
+		if constexpr (PowerPin != One_wire::not_controllable) {
+			gpio_init(PowerPin);
+			gpio_put(PowerPin, !PowerPolarity);// power off before it is driven
+			gpio_set_dir(PowerPin, GPIO_OUT);
+		}
+	}
+
+	/**
+	 * Reset pulse at the profile's timing
+	 *
+	 * @returns true if a device answered with a presence pulse
+	 */
+	bool reset() { return onewire_reset_slot(port, timing, 1) != 0; }
+
+	/**
+	 * Reset and Skip ROM, selecting every device on the bus
+	 *
+	 * @returns false if no device answered the reset
+	 */
+	bool skip_rom() {
+		if (!reset()) {
+			return false;
+		}
+		byte_out(SkipROMCommand);
+		return true;
+	}
+
+	/**
+	 * Reset and Match ROM, selecting one device
+	 *
+	 * @param address ROM code of the device
+	 * @returns false if no device answered the reset
+	 */
+	bool match_rom(const rom_address_t &address) {
+		if (!reset()) {
+			return false;
+		}
+		byte_out(MatchROMCommand);
+		block_out(address.rom, ROMSize);
+		return true;
+	}
+
+	/**
+	 * Reset and Overdrive Skip ROM at standard speed, after which every device
+	 * is at overdrive speed until a standard speed reset. Only of use with the
+	 * Overdrive_timing_profile.
+	 *
+	 * @returns false if no device answered the reset
+	 */
+	bool overdrive_skip_rom() {
+		if (onewire_reset_slot(port, Standard_timing_profile::timing, 1) == 0) {
+			return false;
+		}
+		uint8_t command = OverdriveSkipROMCommand;
+		for (int i = 0; i < 8; i++) {
+			onewire_write_slot(port, Standard_timing_profile::timing, 1, command & 0x01);
+			command >>= 1;
+		}
+		return true;
+	}
+
+	/**
+	 * Read ROM, for a bus with a single device
+	 *
+	 * @param address filled with the ROM code if it passes its CRC
+	 * @returns ok, no_presence, or crc_error (including an all zero shorted bus)
+	 */
+	one_wire_status_t read_rom(rom_address_t &address) {
+		if (!reset()) {
+			return one_wire_status_t::no_presence;
+		}
+		byte_out(ReadROMCommand);
+		rom_address_t read{};
+		block_in(read.rom, ROMSize);
+		if (One_wire_crc::crc8(read.rom, 7) != read.rom[7] || read.rom[0] == 0) {
+			return one_wire_status_t::crc_error;
+		}
+		address = read;
+		return one_wire_status_t::ok;
+	}
+
+	/**
+	 * Match ROM and Read Scratch Pad
+	 *
+	 * @param address ROM code of the device
+	 * @param scratch_pad filled with the ScratchPadSize bytes read
+	 * @returns ok, no_presence, or crc_error
+	 */
+	one_wire_status_t read_scratch_pad(const rom_address_t &address, uint8_t *scratch_pad) {
+		if (!match_rom(address)) {
+			return one_wire_status_t::no_presence;
+		}
+		byte_out(ReadScratchPadCommand);
+		block_in(scratch_pad, ScratchPadSize);
+		if (One_wire_crc::crc8(scratch_pad, ScratchPadSize - 1) != scratch_pad[ScratchPadSize - 1]) {
+			return one_wire_status_t::crc_error;
+		}
+		return one_wire_status_t::ok;
+	}
+
+	void bit_out(bool bit) { onewire_write_slot(port, timing, 1, bit ? 1 : 0, &_slot_overruns); }
+
+	[[nodiscard]] bool bit_in() { return onewire_read_slot(port, timing, 1, &_slot_overruns) != 0; }
+
+	void byte_out(uint8_t data) {
+		for (int i = 0; i < 8; i++) {
+			bit_out(data & 0x01);
+			data >>= 1;
+		}
+	}
+
+	uint8_t byte_in() {
+		uint8_t answer = 0;
+		for (int i = 0; i < 8; i++) {
+			answer >>= 1;
+			if (bit_in()) {
+				answer |= 0x80;
+			}
+		}
+		return answer;
+	}
+
+	void block_out(const uint8_t *data, size_t length) {
+		for (size_t i = 0; i < length; i++) {
+			byte_out(data[i]);
+		}
+	}
+
+	void block_in(uint8_t *data, size_t length) {
+		for (size_t i = 0; i < length; i++) {
+			data[i] = byte_in();
+		}
+	}
+
+	/**
+	 * @returns the number of slots that overran their sample window
+	 */
+	[[nodiscard]] uint32_t slot_overruns() const { return _slot_overruns; }
+
+	/**
+	 * Power parasite devices through a conversion or EEPROM write, with the
+	 * power MOSFET if there is one, otherwise by driving the data line high
+	 *
+	 * @param enable true to turn the strong pull up on, false to release it
+	 */
+	void strong_pullup(bool enable) {
+		if constexpr (PowerPin != One_wire::not_controllable) {
+			gpio_put(PowerPin, enable ? PowerPolarity : !PowerPolarity);
+		} else if (enable) {
+			sio_hw->gpio_set = Sio_pin_port<DataPin>::pin_mask;
+			sio_hw->gpio_oe_set = Sio_pin_port<DataPin>::pin_mask;
+		} else {
+			sio_hw->gpio_oe_clr = Sio_pin_port<DataPin>::pin_mask;
+		}
+	}
+
+private:
+	static constexpr Sio_pin_port<DataPin> port{};
+	uint32_t _slot_overruns{};
+};
+
+
+#endif// PICO_PI_ONEWIRE_FIXED_H
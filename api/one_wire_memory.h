@@ -0,0 +1,147 @@
+/*
+ * pico-pi-one-wire Library, EEPROM and EPROM memory
+ *
+ * Reads and writes the 1k bit memory of the DS2502 and the MAX31826 through
+ * the transaction API, with every transfer checked and a small cache of the
+ * pages already read.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_MEMORY_H
+#define PICO_PI_ONEWIRE_MEMORY_H
+
+#include "one_wire.h"
+
+#ifndef ONE_WIRE_MEMORY_CACHE_PAGES
+#define ONE_WIRE_MEMORY_CACHE_PAGES 8
+#endif
+
+static const int ReadMemoryCommand = 0xF0;
+static const int ReadDataCRCCommand = 0xC3;   // DS2502, each page followed by its CRC8
+static const int WriteScratchPad2Command = 0x0F;// MAX31826
+static const int ReadScratchPad2Command = 0xAA; // MAX31826
+static const int CopyScratchPad2Command = 0x55; // MAX31826
+static const int CopyScratchPad2Validation = 0xA5;
+
+/**
+ * Memory of the devices on a bus
+ *
+ * Reads stream from the starting address to as far as asked in one
+ * transaction. DS2502 reads are checked with the CRC8 the device sends after
+ * the address and after each page, the MAX31826 sends no CRC with its memory
+ * so its reads are checked by reading twice. Writes (MAX31826 only, the DS2502
+ * needs a 12V programming pulse) go through scratch pad 2 eight bytes at a
+ * time, each block is read back from the scratch pad before it is copied and
+ * the memory is read back once written.
+ *
+ * read_page() keeps the pages it reads, the memory only changes through
+ * write() so a cached page is used until then, or until invalidate().
+ *
+ * @code
+ * One_wire_memory memory(one_wire);
+ * uint8_t calibration[One_wire_memory::page_size];
+ *
+ * if (memory.read_page(address, 0, calibration) == one_wire_status_t::ok) {
+ *     ...
+ * }
+ * @endcode
+ */
+class One_wire_memory {
+public:
+	static const size_t memory_size = 128;// both parts have 1k bit
+	static const size_t page_size = 32;
+	static const size_t block_size = 8;   // MAX31826 scratch pad 2
+
+	explicit One_wire_memory(One_wire_base &bus);
+
+	/**
+	 * @returns true for the families with memory this class can read
+	 */
+	static bool supported(uint8_t family);
+
+	/**
+	 * Read memory in one transaction, bypassing the cache
+	 *
+	 * @param address the device to read
+	 * @param offset first byte to read
+	 * @param data filled with the bytes read
+	 * @param length number of bytes, offset + length at most memory_size
+	 * @returns ok, no_presence, crc_error, or unsupported_device for other
+	 *          families or a range outside the memory
+	 */
+	one_wire_status_t read(rom_address_t &address, size_t offset, uint8_t *data, size_t length);
+
+	/**
+	 * Read a page, from the cache if it has been read before
+	 *
+	 * @param address the device to read
+	 * @param page page number, below memory_size / page_size
+	 * @param data filled with the page_size bytes of the page
+	 * @returns as read()
+	 */
+	one_wire_status_t read_page(rom_address_t &address, size_t page, uint8_t *data);
+
+	/**
+	 * Write memory and read it back, any block only partly written keeps the
+	 * rest of its bytes. The cached pages written are dropped.
+	 *
+	 * @param address the device to write, a MAX31826
+	 * @param offset first byte to write
+	 * @param data bytes to write
+	 * @param length number of bytes, offset + length at most memory_size
+	 * @returns ok, no_presence, crc_error if a block or the read back didn't
+	 *          match, or unsupported_device
+	 */
+	one_wire_status_t write(rom_address_t &address, size_t offset, const uint8_t *data, size_t length);
+
+	/**
+	 * Drop every cached page, e.g. after devices have been swapped
+	 */
+	void invalidate();
+
+	/**
+	 * @returns the number of read_page() calls answered from the cache
+	 */
+	[[nodiscard]] uint32_t cache_hits() const { return _cache_hits; }
+
+private:
+	struct cached_page_t {
+		uint64_t id;
+		size_t page;
+		bool valid;
+		uint8_t data[page_size];
+	};
+
+	One_wire_base &_bus;
+	cached_page_t _cache[ONE_WIRE_MEMORY_CACHE_PAGES]{};
+	size_t _next_victim{};
+	uint32_t _cache_hits{};
+
+	one_wire_status_t read_with_crc(rom_address_t &address, size_t offset, uint8_t *data, size_t length);
+
+	one_wire_status_t read_twice(rom_address_t &address, size_t offset, uint8_t *data, size_t length);
+
+	one_wire_status_t write_block(rom_address_t &address, size_t block, const uint8_t *data);
+
+	void invalidate(uint64_t id, size_t first_page, size_t last_page);
+};
+
+
+#endif// PICO_PI_ONEWIRE_MEMORY_H
@@ -0,0 +1,145 @@
+/*
+ * pico-pi-one-wire Library, bit-parallel multi-bus driver
+ *
+ * Runs the same slot on several independent buses at once through the masked
+ * SIO registers, so broadcast operations take the time of one bus however many
+ * buses there are.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_MULTI_H
+#define PICO_PI_ONEWIRE_MULTI_H
+
+#include "one_wire.h"
+
+/**
+ * Several 1-Wire buses driven in lock step
+ *
+ * Bus masks have bit i set for bus i, in the order the pins were given. Bytes
+ * written to every bus can differ from bus to bus, e.g. to select a different
+ * device on each with match_rom.
+ *
+ * @code
+ * const uint pins[] = {10, 11, 12, 13};
+ * One_wire_multi buses(pins, 4);
+ * uint8_t scratch_pads[4][ScratchPadSize];
+ *
+ * buses.init();
+ * buses.convert_temperature();
+ * uint32_t valid = buses.read_scratch_pads(scratch_pads);// one device per bus
+ * @endcode
+ */
+class One_wire_multi {
+public:
+	static const size_t max_buses = 16;
+
+	/**
+	 * @param data_pins pin of each bus
+	 * @param bus_count number of buses, at most max_buses
+	 */
+	One_wire_multi(const uint *data_pins, size_t bus_count);
+
+	/**
+	 * Initialise the pins and find which buses have parasite powered devices
+	 */
+	void init();
+
+	[[nodiscard]] size_t bus_count() const { return _bus_count; }
+
+	/**
+	 * @returns the buses with parasite powered devices, found by init
+	 */
+	[[nodiscard]] uint32_t parasite_buses() const { return _parasite_buses; }
+
+	/**
+	 * Reset every bus at once
+	 *
+	 * @returns the buses where a device answered
+	 */
+	uint32_t reset();
+
+	/**
+	 * Reset and Skip ROM on every bus
+	 *
+	 * @returns the buses where a device answered
+	 */
+	uint32_t skip_rom();
+
+	/**
+	 * Reset and Match ROM, selecting one device on each bus
+	 *
+	 * @param addresses the device to select on each bus
+	 * @returns the buses where a device answered
+	 */
+	uint32_t match_rom(const rom_address_t *addresses);
+
+	/**
+	 * Write the same byte to every bus
+	 */
+	void byte_out(uint8_t data);
+
+	/**
+	 * Write a byte to each bus
+	 *
+	 * @param data byte i is written to bus i
+	 */
+	void bytes_out(const uint8_t *data);
+
+	/**
+	 * Read a block of bytes from every bus
+	 *
+	 * @param data filled with the bytes from bus i at data[i * length]
+	 * @param length number of bytes to read from each bus
+	 */
+	void block_in(uint8_t *data, size_t length);
+
+	/**
+	 * Skip ROM Convert T on every bus. Parasite powered buses get the strong
+	 * pull up for the whole conversion.
+	 *
+	 * @param wait (optional) true (default) to wait for the conversion time
+	 * @returns the buses where a device answered
+	 */
+	uint32_t convert_temperature(bool wait = true);
+
+	/**
+	 * Read the scratch pad of one device on every bus
+	 *
+	 * @param scratch_pads filled with the scratch pad of bus i at scratch_pads[i]
+	 * @param addresses (optional) the device to read on each bus, nullptr (default)
+	 *        uses Skip ROM for buses with a single device
+	 * @returns the buses whose scratch pad passed its CRC
+	 */
+	uint32_t read_scratch_pads(uint8_t (*scratch_pads)[ScratchPadSize], const rom_address_t *addresses = nullptr);
+
+private:
+	uint _pins[max_buses]{};
+	size_t _bus_count;
+	uint32_t _pin_mask{};
+	uint32_t _parasite_buses{};
+	const slot_timing_t *_timing{&One_wire::standard_timing};
+
+	[[nodiscard]] uint32_t to_bus_mask(uint32_t pins) const;
+
+	[[nodiscard]] uint32_t to_pin_mask(uint32_t buses) const;
+};
+
+
+#endif// PICO_PI_ONEWIRE_MULTI_H
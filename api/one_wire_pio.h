@@ -0,0 +1,135 @@
+/*
+ * pico-pi-one-wire Library, PIO bus engine
+ *
+ * Runs the 1-Wire reset, write and read slots on a PIO state machine so the
+ * timing is generated in hardware and no longer stretched by interrupts.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_PIO_H
+#define PICO_PI_ONEWIRE_PIO_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef MOCK_PICO_PI
+
+#include "../test/pico_pi_mocks.h"
+
+#else
+
+#include "hardware/pio.h"
+
+#endif
+
+/**
+ * 1-Wire master running on a PIO state machine
+ *
+ * Bits and bytes are queued through the state machine FIFOs, block transfers
+ * keep the FIFOs full so consecutive slots run back to back.
+ */
+class One_wire_pio {
+public:
+	/**
+	 * Bit 31 of a TX word is never shifted out by the state machine, it is set on
+	 * read requests so that bus traces (and the test mocks) can tell a read slot
+	 * from a write 1 slot.
+	 */
+	static const uint32_t read_marker = 1u << 31;
+
+	static const uint fifo_depth = 4;
+
+	/**
+	 * The program's standard speed slots scale down to overdrive timing when
+	 * the state machine runs this much faster
+	 */
+	static const uint overdrive_speedup = 7;
+
+	explicit One_wire_pio(uint data_pin);
+	~One_wire_pio();
+
+	/**
+	 * Load the program and claim a state machine
+	 *
+	 * @param pio the PIO block to run on (pio0 or pio1)
+	 * @return false if the block has no free state machine or program space
+	 */
+	bool init(PIO pio);
+
+	/**
+	 * Stop the state machine and release the program space
+	 */
+	void deinit();
+
+	[[nodiscard]] bool active() const { return _pio != nullptr; }
+
+	/**
+	 * Issue a reset pulse
+	 *
+	 * @return true if any device answered with a presence pulse
+	 */
+	[[nodiscard]] bool reset() const;
+
+	void bit_out(bool bit_data) const;
+
+	[[nodiscard]] bool bit_in() const;
+
+	void byte_out(uint8_t data) const;
+
+	[[nodiscard]] uint8_t byte_in() const;
+
+	/**
+	 * Write a block of bytes, keeping the FIFO full between bytes
+	 */
+	void block_out(const uint8_t *data, size_t length) const;
+
+	/**
+	 * Read a block of bytes, keeping the FIFO full between bytes
+	 */
+	void block_in(uint8_t *data, size_t length) const;
+
+	/**
+	 * Drive the data line high to supply parasite powered devices
+	 *
+	 * @param enable true to start the strong pull up, false to release the bus
+	 */
+	void strong_pullup(bool enable) const;
+
+	/**
+	 * Switch the slot timing between standard and overdrive speed
+	 *
+	 * @param enable true for overdrive
+	 */
+	void set_overdrive(bool enable) const;
+
+private:
+	PIO _pio{nullptr};
+	uint _sm{0};
+	uint _offset{0};
+	float _clkdiv{1.0f};
+	uint _data_pin;
+
+	[[nodiscard]] uint32_t transfer(uint32_t bits, uint count, bool read) const;
+
+	void block_transfer(const uint8_t *out, uint8_t *in, size_t length) const;
+};
+
+
+#endif// PICO_PI_ONEWIRE_PIO_H
@@ -0,0 +1,119 @@
+/*
+ * pico-pi-one-wire Library, reading queue between cores
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_QUEUE_H
+#define PICO_PI_ONEWIRE_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * One temperature reading
+ */
+struct reading_t {
+	uint64_t id;       // device ID as returned by One_wire::to_uint64
+	uint64_t timestamp;// time_us_64 when the scratch pad was read
+	int16_t raw;       // temperature register, 1/16 degC (1/2 degC for DS18S20)
+	bool crc_ok;
+};
+
+/**
+ * Lock-free ring of readings for exactly one producer and one consumer, e.g.
+ * a bus worker on core 1 and the application on core 0. Neither side ever
+ * blocks, push fails when the ring is full and pop when it is empty.
+ *
+ * Storage is provided by Reading_queue<Capacity>.
+ */
+class Reading_queue_base {
+public:
+	/**
+	 * Producer side
+	 *
+	 * @returns false if the ring is full, the reading is dropped
+	 */
+	bool push(const reading_t &reading) {
+		uint32_t head = _head.load(std::memory_order_relaxed);
+		if (head - _tail.load(std::memory_order_acquire) == _capacity) {
+			return false;
+		}
+		_entries[head & _mask] = reading;
+		_head.store(head + 1, std::memory_order_release);// publish after the entry is written
+		return true;
+	}
+
+	/**
+	 * Consumer side
+	 *
+	 * @returns false if the ring is empty
+	 */
+	bool pop(reading_t &reading) {
+		uint32_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail == _head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		reading = _entries[tail & _mask];
+		_tail.store(tail + 1, std::memory_order_release);// hand the entry back after it is copied
+		return true;
+	}
+
+	/**
+	 * Only a snapshot while the other side is running
+	 */
+	[[nodiscard]] size_t size() const {
+		return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+	}
+
+	[[nodiscard]] size_t capacity() const { return _capacity; }
+
+protected:
+	Reading_queue_base(reading_t *entries, uint32_t capacity)
+			: _entries(entries), _capacity(capacity), _mask(capacity - 1) {}
+
+private:
+	reading_t *_entries;
+	uint32_t _capacity;
+	uint32_t _mask;
+	// free running counts, the difference is the number of queued readings
+	std::atomic<uint32_t> _head{0};// written by the producer only
+	std::atomic<uint32_t> _tail{0};// written by the consumer only
+};
+
+/**
+ * Reading queue holding up to Capacity readings without any heap allocation
+ */
+template<size_t Capacity>
+class Reading_queue : public Reading_queue_base {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "queue capacity must be a power of two");
+
+public:
+	Reading_queue() : Reading_queue_base(_storage, Capacity) {}
+
+	Reading_queue(const Reading_queue &) = delete;
+	Reading_queue &operator=(const Reading_queue &) = delete;
+
+private:
+	reading_t _storage[Capacity]{};
+};
+
+
+#endif// PICO_PI_ONEWIRE_QUEUE_H
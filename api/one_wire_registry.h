@@ -0,0 +1,135 @@
+/*
+ * pico-pi-one-wire Library, per bus device registry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_REGISTRY_H
+#define PICO_PI_ONEWIRE_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+
+static const int ROMSize = 8;
+struct rom_address_t {
+	uint8_t rom[ROMSize];
+};
+
+/**
+ * What is known about one device on the bus
+ */
+struct device_info_t {
+	rom_address_t address;
+	uint64_t id;                 // address as returned by One_wire::to_uint64
+	uint64_t conversion_deadline;// time_us_64 when the last conversion completes
+	int16_t last_raw;            // temperature register from the last good read
+	bool last_raw_valid;
+	uint16_t reads_since_full_read;// fast reads since the last CRC checked read
+	bool seen;                   // answered during the last rescan
+	bool config_cached;          // resolution and alarm thresholds below are known
+	uint8_t resolution;          // conversion resolution in bits
+	int8_t alarm_high;           // T(H) in degC
+	int8_t alarm_low;            // T(L) in degC
+	bool power_cached;           // parasite_powered is known
+	bool parasite_powered;
+	uint32_t crc_errors;         // reads that failed their CRC, each retry counts
+	uint32_t presence_errors;    // transactions with no presence pulse
+};
+
+/**
+ * Fixed capacity store of the devices on one bus, with hashed lookup by ID
+ *
+ * Storage is provided by Device_registry<Capacity>, this base holds the code so
+ * it is shared between every capacity.
+ */
+class Device_registry_base {
+public:
+	[[nodiscard]] size_t size() const { return _size; }
+
+	[[nodiscard]] size_t capacity() const { return _capacity; }
+
+	device_info_t &operator[](size_t index) { return _entries[index]; }
+
+	/**
+	 * @param id device ID as returned by One_wire::to_uint64
+	 * @return the entry or nullptr if the device is not registered
+	 */
+	device_info_t *find(uint64_t id);
+
+	/**
+	 * Register a device, the metadata of a new entry starts zeroed
+	 *
+	 * @return the new or existing entry, nullptr if the registry is full
+	 */
+	device_info_t *add(const rom_address_t &address);
+
+	/**
+	 * Forget a device, the last entry is moved into its place
+	 *
+	 * @return false if the device was not registered
+	 */
+	bool remove(uint64_t id);
+
+	void clear();
+
+protected:
+	Device_registry_base(device_info_t *entries, int16_t *slots, size_t capacity, size_t slot_count)
+			: _entries(entries), _slots(slots), _capacity(capacity), _slot_mask(slot_count - 1) {}
+
+private:
+	device_info_t *_entries;
+	int16_t *_slots;// open addressed hash of entry indexes, -1 when empty
+	size_t _capacity;
+	size_t _slot_mask;
+	size_t _size{0};
+
+	[[nodiscard]] size_t home_slot(uint64_t id) const;
+
+	void index_entry(size_t index);
+};
+
+/**
+ * Device registry holding up to Capacity devices without any heap allocation
+ */
+template<size_t Capacity>
+class Device_registry : public Device_registry_base {
+	static_assert(Capacity > 0 && Capacity < 0x4000, "registry capacity out of range");
+
+public:
+	Device_registry() : Device_registry_base(_storage, _slot_storage, Capacity, slot_count) {
+		clear();
+	}
+
+	Device_registry(const Device_registry &) = delete;
+	Device_registry &operator=(const Device_registry &) = delete;
+
+private:
+	// keep the hash table at most half full
+	static constexpr size_t slot_count_for(size_t slots) {
+		return slots >= Capacity * 2 ? slots : slot_count_for(slots * 2);
+	}
+
+	static constexpr size_t slot_count = slot_count_for(1);
+
+	device_info_t _storage[Capacity];
+	int16_t _slot_storage[slot_count];
+};
+
+
+#endif// PICO_PI_ONEWIRE_REGISTRY_H
@@ -0,0 +1,266 @@
+/*
+ * pico-pi-one-wire Library, bit-banged slot timing
+ *
+ * The reset, write and read slot sequences, written once against a pin mask so
+ * the same timing drives a single bus (One_wire) or several buses at once
+ * through the masked SIO registers (One_wire_multi).
+ *
+ * Every edge is timed against an absolute deadline from the start of its slot,
+ * so an interrupt in a slot's recovery time shortens the recovery rather than
+ * pushing the next edge late. Interrupts are masked only from the falling edge
+ * to the end of a 1 or to the read sample, the few microseconds the devices
+ * are strict about.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_SLOTS_H
+#define PICO_PI_ONEWIRE_SLOTS_H
+
+#include <cstdint>
+
+#ifdef MOCK_PICO_PI
+
+#include "../test/pico_pi_mocks.h"
+
+#else
+
+#include "hardware/gpio.h"
+#include "hardware/structs/sio.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "pico/time.h"
+
+#endif
+
+/**
+ * Bit-banged slot timings in microseconds
+ */
+struct slot_timing_t {
+	uint reset_low;       // hold the bus low to reset
+	uint presence_sample; // after releasing, sample for the presence pulse
+	uint reset_recovery;  // remainder of the presence window
+	uint write_1_low;
+	uint write_1_release;
+	uint write_0_low;
+	uint write_0_release;
+	uint read_low;
+	uint read_sample;     // after releasing, sample the bus
+	uint read_release;    // remainder of the read slot
+	uint sample_window;   // latest a 1 may end, or a read be sampled, after the falling edge
+};
+
+/*
+ * Timing profiles, each a type holding a constexpr slot_timing_t so a bus
+ * specialised on it has every delay as a compile time constant
+ */
+
+/**
+ * Standard speed, as originally tuned for the Pi Pico
+ */
+struct Standard_timing_profile {
+	static constexpr slot_timing_t timing{480, 70, 410, 3, 55, 60, 5, 3, 3, 45, 15};
+};
+
+/**
+ * Overdrive speed, see Maxim application note 126
+ *
+ * The 1us lows and sample margin are no finer than the 1us timer behind
+ * onewire_wait_until, so bit-banged a wait can end almost at once and the
+ * minimum low time is not guaranteed. Overdrive is only reliable on the PIO
+ * engine, whose state machine counts cycles.
+ */
+struct Overdrive_timing_profile {
+	static constexpr slot_timing_t timing{70, 9, 40, 1, 8, 8, 3, 1, 1, 7, 2};
+};
+
+/**
+ * Standard speed for long or heavily loaded cable runs, the application note
+ * 126 recommended values: the line gets longer to rise after each low and
+ * reads are sampled late in their window
+ */
+struct Long_line_timing_profile {
+	static constexpr slot_timing_t timing{480, 70, 410, 6, 64, 60, 10, 6, 9, 55, 15};
+};
+
+/*
+ * A Port drives the pins given by a mask:
+ *   drive_low(mask)   output low
+ *   drive_high(mask)  output high
+ *   release(mask)     input, the pull up floats the bus high
+ *   sample()          the level of every pin, one bit per pin of the mask
+ */
+
+/**
+ * Port for a single data pin, the mask is always 1
+ */
+struct Data_pin_port {
+	uint pin;
+
+	void drive_low(uint32_t) const {
+		gpio_set_dir(pin, GPIO_OUT);
+		gpio_put(pin, false);
+	}
+
+	void drive_high(uint32_t) const { gpio_put(pin, true); }
+
+	void release(uint32_t) const { gpio_set_dir(pin, GPIO_IN); }
+
+	[[nodiscard]] uint32_t sample() const { return gpio_get(pin) ? 1 : 0; }
+};
+
+/**
+ * Port for any set of pins, the mask holds GPIO numbers and every pin changes
+ * in the same SIO register write
+ */
+struct Masked_pins_port {
+	void drive_low(uint32_t mask) const {
+		gpio_put_masked(mask, 0);
+		gpio_set_dir_masked(mask, mask);
+	}
+
+	void drive_high(uint32_t mask) const { gpio_put_masked(mask, mask); }
+
+	void release(uint32_t mask) const { gpio_set_dir_masked(mask, 0); }
+
+	[[nodiscard]] uint32_t sample() const { return gpio_get_all(); }
+};
+
+/**
+ * Port for a data pin fixed at compile time, every call is a single write or
+ * read of an SIO register with a constant mask
+ */
+template<uint Pin>
+struct Sio_pin_port {
+	static constexpr uint32_t pin_mask = 1u << Pin;
+
+	void drive_low(uint32_t) const {
+		sio_hw->gpio_clr = pin_mask;
+		sio_hw->gpio_oe_set = pin_mask;
+	}
+
+	void drive_high(uint32_t) const { sio_hw->gpio_set = pin_mask; }
+
+	void release(uint32_t) const { sio_hw->gpio_oe_clr = pin_mask; }
+
+	[[nodiscard]] uint32_t sample() const { return (sio_hw->gpio_in & pin_mask) != 0 ? 1 : 0; }
+};
+
+/**
+ * Busy wait until time_us_32() reaches deadline, returns at once if it has passed
+ */
+inline void onewire_wait_until(uint32_t deadline) {
+	auto remaining = (int32_t) (deadline - time_us_32());
+	if (remaining > 0) {
+		busy_wait_us_32((uint32_t) remaining);
+	}
+}
+
+/**
+ * Reset pulse on every pin of mask
+ *
+ * @returns the pins where a device answered with a presence pulse
+ */
+template<typename Port>
+inline uint32_t onewire_reset_slot(const Port &port, const slot_timing_t &timing, uint32_t mask) {
+	port.drive_low(mask);
+	uint32_t start = time_us_32();// after the edge, so an interrupt here only makes the reset longer
+	onewire_wait_until(start + timing.reset_low);
+	uint32_t interrupts = save_and_disable_interrupts();
+	uint32_t released = time_us_32();
+	port.release(mask);// let the data line float high
+	restore_interrupts(interrupts);
+	onewire_wait_until(released + timing.presence_sample);// devices wait 15-60us, then hold low for 60-240us
+	interrupts = save_and_disable_interrupts();
+	onewire_wait_until(released + timing.presence_sample);
+	uint32_t presence = ~port.sample() & mask;// devices pull the data line low
+	restore_interrupts(interrupts);
+	onewire_wait_until(released + timing.presence_sample + timing.reset_recovery);
+	return presence;
+}
+
+/**
+ * Write slot on every pin of mask, pins in ones write a 1 and the others a 0
+ *
+ * @param overruns (optional) counts the slot if a 1 ended after the sample
+ *        window or a 0 was held for more than twice its low time
+ */
+template<typename Port>
+inline void onewire_write_slot(const Port &port, const slot_timing_t &timing, uint32_t mask, uint32_t ones,
+							   uint32_t *overruns = nullptr) {
+	ones &= mask;
+	bool overran = false;
+	uint32_t start;
+	if (ones != 0) {
+		uint32_t interrupts = save_and_disable_interrupts();
+		start = time_us_32();
+		port.drive_low(mask);
+		onewire_wait_until(start + timing.write_1_low);// (spec 1-15us)
+		port.drive_high(ones);
+		overran = time_us_32() - start > timing.sample_window;
+		restore_interrupts(interrupts);
+	} else {
+		// an interrupt between the timestamp and the edge would shorten the 0 into a 1
+		uint32_t interrupts = save_and_disable_interrupts();
+		start = time_us_32();
+		port.drive_low(mask);
+		restore_interrupts(interrupts);
+	}
+	if (ones != mask) {
+		onewire_wait_until(start + timing.write_0_low);// (spec 60-120us)
+		port.drive_high(mask & ~ones);
+		overran = overran || time_us_32() - start > 2 * timing.write_0_low;
+	}
+	if (ones == mask) {
+		onewire_wait_until(start + timing.write_1_low + timing.write_1_release);
+	} else {
+		onewire_wait_until(start + timing.write_0_low + timing.write_0_release);// allow bus to float high before next bit
+	}
+	if (overran && overruns != nullptr) {
+		(*overruns)++;
+	}
+}
+
+/**
+ * Read slot on every pin of mask
+ *
+ * @param overruns (optional) counts the slot if it was sampled after the sample window
+ * @returns the pins that read as a 1
+ */
+template<typename Port>
+inline uint32_t onewire_read_slot(const Port &port, const slot_timing_t &timing, uint32_t mask,
+								  uint32_t *overruns = nullptr) {
+	uint32_t interrupts = save_and_disable_interrupts();
+	uint32_t start = time_us_32();
+	port.drive_low(mask);
+	onewire_wait_until(start + timing.read_low);// (spec 1-15us)
+	port.release(mask);
+	onewire_wait_until(start + timing.read_low + timing.read_sample);// (spec read within 15us)
+	uint32_t answer = port.sample() & mask;
+	uint32_t sampled = time_us_32();
+	restore_interrupts(interrupts);
+	if (sampled - start > timing.sample_window && overruns != nullptr) {
+		(*overruns)++;
+	}
+	onewire_wait_until(start + timing.read_low + timing.read_sample + timing.read_release);
+	return answer;
+}
+
+
+#endif// PICO_PI_ONEWIRE_SLOTS_H
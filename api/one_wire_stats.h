@@ -0,0 +1,169 @@
+/*
+ * pico-pi-one-wire Library, bus statistics
+ *
+ * Counts what happens on a bus and where the bus time goes, to tune polling
+ * intervals and to spot cable runs that are starting to fail. Build with
+ * ONE_WIRE_STATS defined as 1 to enable, otherwise the recorder is empty and
+ * every call to it compiles away.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_STATS_H
+#define PICO_PI_ONEWIRE_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef MOCK_PICO_PI
+
+#include "../test/pico_pi_mocks.h"
+
+#else
+
+#include "pico/time.h"
+
+#endif
+
+#ifndef ONE_WIRE_STATS
+#define ONE_WIRE_STATS 0
+#endif
+
+/**
+ * What the bus was doing, bus time is charged to the operation in progress
+ */
+enum class bus_operation_t {
+	other,            // ROM reads, power supply checks, presence probes
+	search,
+	convert,          // Convert T and waiting for it
+	read_scratch_pad,
+	write_scratch_pad // including Copy Scratch Pad and its EEPROM write
+};
+
+static const size_t bus_operation_count = 5;
+
+struct bus_operation_stats_t {
+	uint64_t reset_us;// reset pulses and presence detect
+	uint64_t slot_us; // read and write time slots
+	uint64_t wait_us; // conversion and EEPROM write waits
+};
+
+struct bus_stats_t {
+	uint32_t resets;
+	uint32_t presence_failures;// resets nothing answered
+	uint32_t crc_failures;     // scratch pads and ROM codes read with a bad CRC
+	uint32_t search_passes;    // each pass through the search tree finds one device
+	uint64_t bits_written;
+	uint64_t bits_read;
+	bus_operation_stats_t operations[bus_operation_count];// indexed by bus_operation_t
+};
+
+/**
+ * Records bus_stats_t for a One_wire bus, every method is a no-op unless
+ * ONE_WIRE_STATS is 1
+ */
+class One_wire_stats {
+public:
+	/**
+	 * Charges bus time to an operation while in scope, the outer operation
+	 * is restored after
+	 */
+	class Operation {
+	public:
+#if ONE_WIRE_STATS
+		Operation(One_wire_stats &stats, bus_operation_t operation)
+				: _stats(stats), _outer(stats._operation) {
+			stats._operation = operation;
+		}
+
+		~Operation() { _stats._operation = _outer; }
+
+	private:
+		One_wire_stats &_stats;
+		bus_operation_t _outer;
+#else
+		Operation(One_wire_stats &, bus_operation_t) {}
+#endif
+	};
+
+#if ONE_WIRE_STATS
+	/**
+	 * @returns the time now, to pass back as the start of a reset, slots or wait
+	 */
+	static uint64_t now() { return time_us_64(); }
+
+	void reset(uint64_t start, bool presence) {
+		_stats.resets++;
+		if (!presence) {
+			_stats.presence_failures++;
+		}
+		current().reset_us += time_us_64() - start;
+	}
+
+	void bits_written(uint64_t start, uint32_t bits) {
+		_stats.bits_written += bits;
+		current().slot_us += time_us_64() - start;
+	}
+
+	void bits_read(uint64_t start, uint32_t bits) {
+		_stats.bits_read += bits;
+		current().slot_us += time_us_64() - start;
+	}
+
+	void wait(uint64_t start) { current().wait_us += time_us_64() - start; }
+
+	void crc_failure() { _stats.crc_failures++; }
+
+	void search_pass() { _stats.search_passes++; }
+
+	[[nodiscard]] const bus_stats_t &stats() const { return _stats; }
+
+	void clear() { _stats = bus_stats_t{}; }
+
+private:
+	bus_stats_t _stats{};
+	bus_operation_t _operation{bus_operation_t::other};
+
+	bus_operation_stats_t &current() { return _stats.operations[(size_t) _operation]; }
+#else
+	static uint64_t now() { return 0; }
+
+	void reset(uint64_t, bool) {}
+
+	void bits_written(uint64_t, uint32_t) {}
+
+	void bits_read(uint64_t, uint32_t) {}
+
+	void wait(uint64_t) {}
+
+	void crc_failure() {}
+
+	void search_pass() {}
+
+	[[nodiscard]] const bus_stats_t &stats() const {
+		static const bus_stats_t none{};
+		return none;
+	}
+
+	void clear() {}
+#endif
+};
+
+
+#endif// PICO_PI_ONEWIRE_STATS_H
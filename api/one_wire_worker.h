@@ -0,0 +1,140 @@
+/*
+ * pico-pi-one-wire Library, core 1 bus worker
+ *
+ * Runs enumeration, conversions and scratch pad reads on the second core and
+ * passes the readings back through a lock-free queue, so the core the
+ * application runs on never waits for the bus.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PICO_PI_ONEWIRE_WORKER_H
+#define PICO_PI_ONEWIRE_WORKER_H
+
+#include <atomic>
+
+#include "one_wire.h"
+#include "one_wire_queue.h"
+
+/**
+ * Owns a bus once started, the bus object must not be used from core 0 until
+ * the worker has stopped.
+ *
+ * Storage is provided by One_wire_worker<QueueCapacity, MaxDevices>.
+ */
+class One_wire_worker_base {
+public:
+	/**
+	 * Launch the worker on core 1, the first cycle enumerates the bus. Core 1
+	 * is reset first, so a worker can be started again once stopped().
+	 *
+	 * @returns false if a worker is already running on core 1
+	 */
+	bool start();
+
+	/**
+	 * Ask the worker to stop, it finishes the cycle in progress first
+	 */
+	void stop();
+
+	[[nodiscard]] bool stopped() const { return _stopped.load(std::memory_order_acquire); }
+
+	/**
+	 * Enumerate the bus again at the start of the next cycle
+	 */
+	void request_rescan();
+
+	/**
+	 * Take the oldest reading, never blocks
+	 *
+	 * @returns false if there is no reading waiting
+	 */
+	bool pop(reading_t &reading) { return _queue.pop(reading); }
+
+	/**
+	 * @returns the number of readings lost because the queue was full
+	 */
+	[[nodiscard]] uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+	/**
+	 * One worker cycle: enumerate if asked, wait for the period to come round,
+	 * convert every device and queue the readings. Core 1 runs this in a loop,
+	 * it can also be called directly to run the worker on a single core.
+	 */
+	void step();
+
+protected:
+	One_wire_worker_base(One_wire_base &bus, Reading_queue_base &queue, bus_readings_t &readings, uint32_t period_ms)
+			: _bus(bus), _queue(queue), _readings(readings), _period_us((uint64_t) period_ms * 1000) {}
+
+private:
+	One_wire_base &_bus;
+	Reading_queue_base &_queue;
+	bus_readings_t &_readings;
+	uint64_t _period_us;
+	uint64_t _next_cycle{};
+	std::atomic<bool> _rescan_requested{true};
+	std::atomic<bool> _stop_requested{false};
+	std::atomic<bool> _stopped{true};
+	std::atomic<uint32_t> _dropped{0};
+
+	static void core1_entry();
+
+	void run();
+};
+
+/**
+ * Bus worker queueing up to QueueCapacity readings for a bus of up to
+ * MaxDevices devices
+ *
+ * @code
+ * One_wire one_wire(15);
+ * One_wire_worker<64> worker(one_wire, 1000);
+ *
+ * one_wire.init();
+ * worker.start();
+ * while (true) {
+ *     reading_t reading;
+ *     while (worker.pop(reading)) {
+ *         // ...
+ *     }
+ *     // networking etc.
+ * }
+ * @endcode
+ */
+template<size_t QueueCapacity, size_t MaxDevices = One_wire::default_max_devices>
+class One_wire_worker : public One_wire_worker_base {
+public:
+	/**
+	 * @param bus the bus to run, already initialised
+	 * @param period_ms time from the start of one conversion cycle to the next
+	 */
+	One_wire_worker(One_wire_base &bus, uint32_t period_ms)
+			: One_wire_worker_base(bus, _queue_storage, _readings_storage, period_ms) {}
+
+	One_wire_worker(const One_wire_worker &) = delete;
+	One_wire_worker &operator=(const One_wire_worker &) = delete;
+
+private:
+	Reading_queue<QueueCapacity> _queue_storage;
+	Bus_readings<MaxDevices> _readings_storage;
+};
+
+
+#endif// PICO_PI_ONEWIRE_WORKER_H
@@ -1,9 +1,7 @@
 #include "../api/one_wire.h"
-#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <vector>
 
 #ifdef MOCK_PICO_PI
 
@@ -15,16 +13,19 @@
 
 #endif
 
-std::vector<rom_address_t> found_addresses;
+const slot_timing_t One_wire_base::standard_timing = Standard_timing_profile::timing;
+const slot_timing_t One_wire_base::overdrive_timing = Overdrive_timing_profile::timing;
 
-One_wire::One_wire(uint data_pin, uint power_pin, bool power_polarity)
+One_wire_base::One_wire_base(Device_registry_base &registry, uint data_pin, uint power_pin, bool power_polarity)
 		: _data_pin(data_pin),
 		  _parasite_pin(power_pin),
+		  _power_mosfet(power_pin != not_controllable),
 		  _power_polarity(power_polarity),
-		  _power_mosfet(power_pin != not_controllable) {
+		  _pio_engine(data_pin),
+		  _devices(registry) {
 }
 
-void One_wire::init() {
+void One_wire_base::init() {
 	gpio_init(_data_pin);
 	if (_parasite_pin != not_controllable) {
 		gpio_init(_parasite_pin);
@@ -35,84 +36,329 @@ void One_wire::init() {
 
 	rom_address_t address{};
 	_parasite_power = !power_supply_available(address, true);
+	_stats.clear();
+	_slot_overruns = 0;
 }
 
-One_wire::~One_wire() {
-	found_addresses.clear();
+bool One_wire_base::use_pio(PIO pio) {
+	return _pio_engine.init(pio);
 }
 
-bool One_wire::reset_check_for_device() const {
+One_wire_base::~One_wire_base() = default;
+
+bool One_wire_base::reset_check_for_device() {
 	// This will return false if no devices are present on the data bus
-	bool presence = false;
-	gpio_init(_data_pin);
-	gpio_set_dir(_data_pin, GPIO_OUT);
-	gpio_put(_data_pin, false); // bring low for 480us
-	sleep_us(480);
-	gpio_set_dir(_data_pin, GPIO_IN); // let the data line float high
-	sleep_us(70); // wait 70us
-	if (!gpio_get(_data_pin)) {
-		// see if any devices are pulling the data line low
-		presence = true;
-	}
-	sleep_us(410);
+	_conversion_on_bus = false;
+	bool presence = reset_pulse();
+	if (!presence && overdrive()) {
+		// nothing is answering at overdrive speed, a standard reset returns
+		// every device to standard speed
+		set_standard_speed();
+		presence = reset_pulse();
+	}
 	return presence;
 }
 
-void One_wire::onewire_bit_out(bool bit_data) const {
-	gpio_set_dir(_data_pin, GPIO_OUT);
-	gpio_put(_data_pin, false);
-	sleep_us(3);// (spec 1-15us)
-	if (bit_data) {
-		gpio_put(_data_pin, true);
-		sleep_us(55);
+bool One_wire_base::reset_pulse() {
+	uint64_t start = One_wire_stats::now();
+	bool presence;
+	if (_pio_engine.active()) {
+		presence = _pio_engine.reset();
 	} else {
-		sleep_us(60);// (spec 60-120us)
-		gpio_put(_data_pin, true);
-		sleep_us(5);// allow bus to float high before next bit_out
+		gpio_init(_data_pin);
+		presence = onewire_reset_slot(Data_pin_port{_data_pin}, *_timing, 1) != 0;
 	}
+	_stats.reset(start, presence);
+	return presence;
 }
 
-void One_wire::onewire_byte_out(uint8_t data) {
-	int n;
-	for (n = 0; n < 8; n++) {
-		onewire_bit_out((bool) (data & 0x01));
-		data = data >> 1;// now the next bit is in the least sig bit position.
+void One_wire_base::set_timing(const slot_timing_t &timing) {
+	_timing = &timing;
+	if (_pio_engine.active()) {
+		_pio_engine.set_overdrive(&timing == &overdrive_timing);
 	}
 }
 
-bool One_wire::onewire_bit_in() const {
-	bool answer;
-	gpio_set_dir(_data_pin, GPIO_OUT);
-	gpio_put(_data_pin, false);
-	sleep_us(3);// (spec 1-15us)
-	gpio_set_dir(_data_pin, GPIO_IN);
-	sleep_us(3);// (spec read within 15us)
-	answer = gpio_get(_data_pin);
-	sleep_us(45);
-	return answer;
+void One_wire_base::set_standard_speed() {
+	set_timing(standard_timing);
+}
+
+bool One_wire_base::overdrive_skip_rom() {
+	set_standard_speed();
+	if (!reset_check_for_device()) {
+		return false;
+	}
+	onewire_byte_out(OverdriveSkipROMCommand);
+	set_timing(overdrive_timing);
+	return true;
+}
+
+bool One_wire_base::overdrive_match_rom(rom_address_t &address) {
+	set_standard_speed();
+	if (!reset_check_for_device()) {
+		return false;
+	}
+	onewire_byte_out(OverdriveMatchROMCommand);
+	set_timing(overdrive_timing);
+	onewire_block_out(address.rom, ROMSize);
+	return true;
+}
+
+void One_wire_base::onewire_bit_out(bool bit_data) const {
+	uint64_t start = One_wire_stats::now();
+	if (_pio_engine.active()) {
+		_pio_engine.bit_out(bit_data);
+	} else {
+		onewire_write_slot(Data_pin_port{_data_pin}, *_timing, 1, bit_data ? 1 : 0, &_slot_overruns);
+	}
+	_stats.bits_written(start, 1);
+}
+
+void One_wire_base::onewire_byte_out(uint8_t data) {
+	if (_pio_engine.active()) {
+		uint64_t start = One_wire_stats::now();
+		_pio_engine.byte_out(data);
+		_stats.bits_written(start, 8);
+		return;
+	}
+	onewire_block_out(&data, 1);
+}
+
+bool One_wire_base::onewire_bit_in() const {
+	uint64_t start = One_wire_stats::now();
+	bool bit;
+	if (_pio_engine.active()) {
+		bit = _pio_engine.bit_in();
+	} else {
+		bit = onewire_read_slot(Data_pin_port{_data_pin}, *_timing, 1, &_slot_overruns) != 0;
+	}
+	_stats.bits_read(start, 1);
+	return bit;
 }
 
-uint8_t One_wire::onewire_byte_in() {
+uint8_t One_wire_base::onewire_byte_in() {
 	uint8_t answer = 0x00;
-	int i;
-	for (i = 0; i < 8; i++) {
-		answer = answer >> 1;// shift over to make room for the next bit
-		if (onewire_bit_in())
-			answer = (uint8_t) (answer | 0x80);// if the data port is high, make this bit a 1
+	if (_pio_engine.active()) {
+		uint64_t start = One_wire_stats::now();
+		answer = _pio_engine.byte_in();
+		_stats.bits_read(start, 8);
+		return answer;
 	}
+	onewire_block_in(&answer, 1);
 	return answer;
 }
 
-int One_wire::find_and_count_devices_on_bus() {
-	found_addresses.clear();
-	_last_discrepancy = 0;	// start search from begining
-	_last_device = 0;
-	while (search_rom_find_next()) {
+void One_wire_base::onewire_block_out(const uint8_t *data, size_t length) {
+	uint64_t start = One_wire_stats::now();
+	if (_pio_engine.active()) {
+		_pio_engine.block_out(data, length);
+	} else {
+		// the slots are inlined into one loop over the buffer, the pin and timing looked up once
+		const Data_pin_port port{_data_pin};
+		const slot_timing_t &timing = *_timing;
+		for (size_t i = 0; i < length; i++) {
+			uint8_t byte = data[i];
+			for (int n = 0; n < 8; n++) {
+				onewire_write_slot(port, timing, 1, byte & 0x01, &_slot_overruns);
+				byte = byte >> 1;// now the next bit is in the least sig bit position.
+			}
+		}
 	}
-	return (int) found_addresses.size();
+	_stats.bits_written(start, (uint32_t) length * 8);
 }
 
-rom_address_t One_wire::address_from_hex(const char *hex_address) {
+void One_wire_base::onewire_block_in(uint8_t *data, size_t length) {
+	uint64_t start = One_wire_stats::now();
+	if (_pio_engine.active()) {
+		_pio_engine.block_in(data, length);
+	} else {
+		const Data_pin_port port{_data_pin};
+		const slot_timing_t &timing = *_timing;
+		for (size_t i = 0; i < length; i++) {
+			uint8_t answer = 0x00;
+			for (int n = 0; n < 8; n++) {
+				answer = answer >> 1;// shift over to make room for the next bit
+				if (onewire_read_slot(port, timing, 1, &_slot_overruns) != 0) {
+					answer = (uint8_t) (answer | 0x80);// if the data port is high, make this bit a 1
+				}
+			}
+			data[i] = answer;
+		}
+	}
+	_stats.bits_read(start, (uint32_t) length * 8);
+}
+
+bool One_wire_base::reset() {
+	return reset_check_for_device();
+}
+
+bool One_wire_base::select(rom_address_t &address) {
+	return match_rom(address);
+}
+
+bool One_wire_base::select_all() {
+	return skip_rom();
+}
+
+void One_wire_base::write(const uint8_t *data, size_t length) {
+	onewire_block_out(data, length);
+}
+
+void One_wire_base::read(uint8_t *data, size_t length) {
+	onewire_block_in(data, length);
+}
+
+void One_wire_base::write_byte(uint8_t data) {
+	onewire_byte_out(data);
+}
+
+uint8_t One_wire_base::read_byte() {
+	return onewire_byte_in();
+}
+
+void One_wire_base::write_bit(bool bit) {
+	onewire_bit_out(bit);
+}
+
+bool One_wire_base::read_bit() {
+	return onewire_bit_in();
+}
+
+one_wire_status_t One_wire_base::transaction(rom_address_t *address, const uint8_t *out, size_t out_length, uint8_t *in,
+										size_t in_length) {
+	bool presence = address != nullptr ? match_rom(*address) : skip_rom();
+	if (!presence) {
+		return one_wire_status_t::no_presence;
+	}
+	onewire_block_out(out, out_length);
+	onewire_block_in(in, in_length);
+	return one_wire_status_t::ok;
+}
+
+int One_wire_base::find_and_count_devices_on_bus() {
+	search_state_t search;
+	rom_address_t address{};
+	_devices.clear();
+	search_begin(search);
+	while (search_next(search, address)) {
+		if (_devices.add(address) == nullptr) {
+			break;// registry full
+		}
+	}
+	return (int) _devices.size();
+}
+
+int One_wire_base::find_alarmed_devices(rom_address_t *addresses, int max_devices) {
+	search_state_t search;
+	int count = 0;
+	search_begin(search, 0, AlarmSearchCommand);
+	while (count < max_devices && search_next(search, addresses[count])) {
+		count++;
+	}
+	return count;
+}
+
+int One_wire_base::find_devices_of_family(uint8_t family, rom_address_t *addresses, int max_devices) {
+	search_state_t search;
+	int count = 0;
+	search_begin(search, family);
+	while (count < max_devices && search_next(search, addresses[count])) {
+		count++;
+	}
+	return count;
+}
+
+int One_wire_base::rescan(bus_changes_t &changes) {
+	bool changed = false;
+	changes.added_count = 0;
+	changes.removed_count = 0;
+	for (size_t i = 0; i < _devices.size(); i++) {
+		_devices[i].seen = device_present(_devices[i].address);
+		changed = changed || !_devices[i].seen;
+	}
+	if (_devices.size() == 0) {
+		changed = reset_check_for_device();
+	}
+	_rescans_since_search++;
+	if (changed || (_full_search_interval != 0 && _rescans_since_search >= _full_search_interval)) {
+		rescan_full_search(changes);
+	}
+	return (int) _devices.size();
+}
+
+void One_wire_base::rescan_full_search(bus_changes_t &changes) {
+	search_state_t search;
+	rom_address_t address{};
+	_rescans_since_search = 0;
+	for (size_t i = 0; i < _devices.size(); i++) {
+		_devices[i].seen = false;
+	}
+	search_begin(search);
+	bool found_any = false;
+	while (search_next(search, address)) {
+		found_any = true;
+		device_info_t *device = _devices.find(to_uint64(address));
+		if (device == nullptr) {
+			device = _devices.add(address);
+			if (device == nullptr) {
+				break;// registry full
+			}
+			if (changes.added_count < changes.capacity) {
+				changes.added[changes.added_count++] = address;
+			}
+		}
+		device->seen = true;
+	}
+	if (!search.last_device && !(search.no_presence && !found_any)) {
+		return;// the search failed part way, keep the devices it did not reach
+	}
+	// complete, or nothing answered the first reset so every device has gone
+	// removal moves the last entry into the gap, so walk backwards
+	for (size_t i = _devices.size(); i-- > 0;) {
+		if (!_devices[i].seen) {
+			if (changes.removed_count < changes.capacity) {
+				changes.removed[changes.removed_count++] = _devices[i].address;
+			}
+			_devices.remove(_devices[i].id);
+		}
+	}
+}
+
+void One_wire_base::set_full_search_interval(unsigned int rescans) {
+	_full_search_interval = rescans;
+}
+
+bool One_wire_base::device_present(rom_address_t &address) {
+	// a search pass seeded with the address takes its branch at every discrepancy, so it only
+	// comes back with that address if the device answered, whatever its family (application note 187)
+	search_state_t search;
+	rom_address_t found{};
+	search_begin(search);
+	memcpy(search.rom, address.rom, ROMSize);
+	search.last_discrepancy = 64;
+	return search_rom_find_next(search, found) && memcmp(found.rom, address.rom, ROMSize) == 0;
+}
+
+void One_wire_base::search_begin(search_state_t &search, uint8_t family, uint8_t command) {
+	search = search_state_t{};
+	search.command = command;
+	search.family = family;
+	if (family != 0) {
+		// Seed the search with the family code so it heads straight to that
+		// branch of the tree, see Maxim application note 187
+		search.rom[0] = family;
+		search.last_discrepancy = 64;
+	}
+}
+
+bool One_wire_base::search_next(search_state_t &search, rom_address_t &address) {
+	if (search.last_device) {
+		return false;
+	}
+	return search_rom_find_next(search, address);
+}
+
+rom_address_t One_wire_base::address_from_hex(const char *hex_address) {
 	rom_address_t address = rom_address_t();
 	for (uint8_t i = 0; i < ROMSize; i++) {
 		char buffer[3];
@@ -123,11 +369,19 @@ rom_address_t One_wire::address_from_hex(const char *hex_address) {
 	return address;
 }
 
-rom_address_t &One_wire::get_address(int index) {
-	return found_addresses[index];
+rom_address_t &One_wire_base::get_address(int index) {
+	return _devices[index].address;
+}
+
+int One_wire_base::device_count() const {
+	return (int) _devices.size();
+}
+
+device_info_t *One_wire_base::find_device(rom_address_t &address) {
+	return _devices.find(to_uint64(address));
 }
 
-void One_wire::bit_write(uint8_t &value, int bit, bool set) {
+void One_wire_base::bit_write(uint8_t &value, int bit, bool set) {
 	if (bit <= 7 && bit >= 0) {
 		if (set) {
 			value |= (1 << bit);
@@ -137,44 +391,60 @@ void One_wire::bit_write(uint8_t &value, int bit, bool set) {
 	}
 }
 
-void One_wire::single_device_read_rom(rom_address_t &rom_address) {
-	if (!reset_check_for_device()) {
-		return;
-	} else {
+one_wire_status_t One_wire_base::single_device_read_rom(rom_address_t &rom_address) {
+	one_wire_status_t status = one_wire_status_t::ok;
+	for (unsigned int attempt = 0; attempt <= _retries; attempt++) {
+		if (attempt > 0 && _retry_delay_us != 0) {
+			sleep_us((int) _retry_delay_us);
+		}
+		rom_address_t read{};
+		if (!reset_check_for_device()) {
+			status = one_wire_status_t::no_presence;
+			continue;
+		}
 		onewire_byte_out(ReadROMCommand);
-		for (int bit_index = 0; bit_index < 64; bit_index++) {
-			bool bit = onewire_bit_in();
-			bit_write((uint8_t &) rom_address.rom[bit_index / 8], (bit_index % 8), bit);
+		onewire_block_in(read.rom, ROMSize);
+		// a shorted bus reads all zeros, which passes the CRC
+		if (rom_checksum_error(read.rom) || read.rom[0] == 0) {
+			_stats.crc_failure();
+			status = one_wire_status_t::crc_error;
+			continue;
 		}
+		rom_address = read;
+		return one_wire_status_t::ok;
 	}
+	return status;
 }
 
-bool One_wire::search_rom_find_next() {
-
-
+bool One_wire_base::search_rom_find_next(search_state_t &search, rom_address_t &address) {
 	int discrepancy_marker, rom_bit_index;
 	bool bitA, bitB;
 	uint8_t byte_counter, bit_mask;
+	uint8_t *_search_ROM = search.rom;
+	uint8_t command = search.command;
+	int &_last_discrepancy = search.last_discrepancy;
+	One_wire_stats::Operation operation(_stats, bus_operation_t::search);
 
-	if (!reset_check_for_device()) {
-		printf("Failed to reset one wire bus\n");
+	search.no_presence = !reset_check_for_device();
+	if (search.no_presence) {
 		return false;
 	} else {
-		if (_last_device) {
+		if (search.last_device) {
 			return false;	// all devices found
 		}
+		_stats.search_pass();
 		rom_bit_index = 1;
 		discrepancy_marker = 0;
-		onewire_byte_out(SearchROMCommand);
+		onewire_byte_out(command);
 		byte_counter = 0;
 		bit_mask = 0x01;
 		while (rom_bit_index <= 64) {
 			bitA = onewire_bit_in();
 			bitB = onewire_bit_in();
 			if (bitA & bitB) {
-				discrepancy_marker = 0;// data read error, this should never happen
+				// data read error, nothing answered (expected from an alarm search with no alarms)
+				discrepancy_marker = 0;
 				rom_bit_index = 0xFF;
-				printf("Data read error - no devices on bus?\r\n");
 			} else {
 				if (bitA | bitB) {
 					// Set ROM bit to Bit_A
@@ -204,6 +474,12 @@ bool One_wire::search_rom_find_next() {
 				onewire_bit_out(_search_ROM[byte_counter] & bit_mask);
 				rom_bit_index++;
 				if (bit_mask & 0x80) {
+					if (byte_counter == 0 && search.family != 0 && _search_ROM[0] != search.family) {
+						// the remaining devices are all of other families, the
+						// reset at the start of the next command ends this search
+						search.last_device = true;
+						return false;
+					}
 					byte_counter++;
 					bit_mask = 0x01;
 				} else {
@@ -221,15 +497,13 @@ bool One_wire::search_rom_find_next() {
 			#endif
 
 			if (rom_checksum_error(_search_ROM)) {// Check the CRC
-				printf("failed crc\r\n");
+				_stats.crc_failure();
 				return false;
 			}
-			rom_address_t address{};
 			for (byte_counter = 0; byte_counter < 8; byte_counter++) {
 				address.rom[byte_counter] = _search_ROM[byte_counter];
 			}
-			found_addresses.push_back(address);
-			_last_device = _last_discrepancy == 0;
+			search.last_device = _last_discrepancy == 0;
 			return true;
 		} else {
 			return false;
@@ -237,165 +511,493 @@ bool One_wire::search_rom_find_next() {
 	}
 }
 
-void One_wire::match_rom(rom_address_t &address) {
-	int i;
-	if (reset_check_for_device()) {
-		onewire_byte_out(MatchROMCommand);
-		for (i = 0; i < 8; i++) {
-			onewire_byte_out(address.rom[i]);
-		}
-	} else {
-		printf("match_rom failed\n");
+bool One_wire_base::match_rom(rom_address_t &address) {
+	if (!reset_check_for_device()) {
+		return false;
+	}
+	onewire_byte_out(MatchROMCommand);
+	onewire_block_out(address.rom, ROMSize);
+	return true;
+}
+
+bool One_wire_base::skip_rom() {
+	if (!reset_check_for_device()) {
+		return false;
 	}
+	onewire_byte_out(SkipROMCommand);
+	return true;
 }
 
-void One_wire::skip_rom() {
-	if (reset_check_for_device()) {
-		onewire_byte_out(SkipROMCommand);
+void One_wire_base::set_retry_policy(unsigned int retries, unsigned int retry_delay_us) {
+	_retries = retries;
+	_retry_delay_us = retry_delay_us;
+}
+
+bool One_wire_base::rom_checksum_error(uint8_t *address) {
+	// After 7 bytes CRC should equal the 8th byte (ROM CRC)
+	return (One_wire_crc::crc8(address, 7) != address[7]);// will return true if there is a CRC checksum mis-match
+}
+
+int One_wire_base::conversion_delay(rom_address_t &address, bool all) {
+	if (all)
+		return 750;// Converting ALL devices, wait maximum time
+	return conversion_time(address, _devices.find(to_uint64(address)));
+}
+
+int One_wire_base::conversion_time(rom_address_t &address, const device_info_t *device) {
+	int delay_time = 750;// Default delay time
+	if ((FAMILY_CODE == FAMILY_CODE_DS18B20) || (FAMILY_CODE == FAMILY_CODE_DS1822)) {
+		if (device == nullptr || !device->config_cached)
+			return delay_time;// resolution unknown, wait for 12 bits
+		if (device->resolution == 9)
+			delay_time = 94;
+		if (device->resolution == 10)
+			delay_time = 188;
+		if (device->resolution == 11)
+			delay_time = 375;
+		//Note 12bits uses the 750ms default
+	}
+	if (FAMILY_CODE == FAMILY_CODE_MAX31826) {
+		delay_time = 150;// 12bit conversion
+	}
+	return delay_time;
+}
+
+void One_wire_base::strong_pullup(bool enable) {
+	if (_power_mosfet) {
+		gpio_put(_parasite_pin, enable ? _power_polarity : !_power_polarity);
+	} else if (_pio_engine.active()) {
+		_pio_engine.strong_pullup(enable);
+	} else if (enable) {
+		gpio_set_dir(_data_pin, GPIO_OUT);
+		gpio_put(_data_pin, true);
 	} else {
-		printf("skip_rom failed\n");
+		gpio_set_dir(_data_pin, GPIO_IN);
 	}
+	_strong_pullup = enable;
 }
 
-bool One_wire::rom_checksum_error(uint8_t *address) {
-	uint8_t crc = 0x00;
-	int i;
-	for (i = 0; i < 7; i++) {// Only going to shift the lower 7 bytes
-		crc = crc_byte(crc, address[i]);
+int One_wire_base::start_conversion(rom_address_t &address, bool all) {
+	One_wire_stats::Operation operation(_stats, bus_operation_t::convert);
+	int delay_time = conversion_delay(address, all);
+	// Skip ROM will convert for ALL devices
+	if (!(all ? skip_rom() : match_rom(address))) {
+		return conversion_not_started;
 	}
-	// After 7 bytes CRC should equal the 8th byte (ROM CRC)
-	return (crc != address[7]);// will return true if there is a CRC checksum mis-match
-}
-
-bool One_wire::ram_checksum_error() {
-	uint8_t crc = 0x00;
-	int i;
-	for (i = 0; i < 8; i++) {// Only going to shift the lower 8 bytes
-		crc = crc_byte(crc, ram[i]);
-	}
-	// After 8 bytes CRC should equal the 9th byte (RAM CRC)
-	return (crc != ram[8]);// will return true if there is a CRC checksum mis-match
-}
-
-uint8_t One_wire::crc_byte(uint8_t crc, uint8_t byte) {
-	int j;
-	for (j = 0; j < 8; j++) {
-		if ((byte & 0x01) ^ (crc & 0x01)) {
-			// DATA ^ LSB CRC = 1
-			crc = crc >> 1;
-			// Set the MSB to 1
-			crc = (uint8_t) (crc | 0x80);
-			// Check bit 3
-			if (crc & 0x04) {
-				crc = (uint8_t) (crc & 0xFB);// Bit 3 is set, so clear it
-			} else {
-				crc = (uint8_t) (crc | 0x04);// Bit 3 is clear, so set it
-			}
-			// Check bit 4
-			if (crc & 0x08) {
-				crc = (uint8_t) (crc & 0xF7);// Bit 4 is set, so clear it
-			} else {
-				crc = (uint8_t) (crc | 0x08);// Bit 4 is clear, so set it
-			}
-		} else {
-			// DATA ^ LSB CRC = 0
-			crc = crc >> 1;
-			// clear MSB
-			crc = (uint8_t) (crc & 0x7F);
-			// No need to check bits, with DATA ^ LSB CRC = 0, they will remain unchanged
+
+	onewire_byte_out(ConvertTempCommand);// perform temperature conversion
+	if (conversion_needs_pullup(address, all)) {
+		strong_pullup(true);// Parasite power strong pull up until the conversion completes
+	} else {
+		_conversion_on_bus = true;
+		_conversion_on_bus_all = all;
+		_conversion_on_bus_id = to_uint64(address);
+	}
+
+	uint64_t deadline = time_us_64() + (uint64_t) delay_time * 1000;
+	device_info_t *device;
+	if (all) {
+		_bus_conversion_deadline = deadline;
+		for (size_t i = 0; i < _devices.size(); i++) {
+			_devices[i].conversion_deadline = deadline;
 		}
-		byte = byte >> 1;
+	} else if ((device = _devices.find(to_uint64(address))) != nullptr) {
+		device->conversion_deadline = deadline;
+	} else if (deadline > _bus_conversion_deadline) {
+		_bus_conversion_deadline = deadline;// not registered, track it with the whole bus
 	}
-	return crc;
+	return delay_time;
 }
 
-int One_wire::convert_temperature(rom_address_t &address, bool wait, bool all) {
-	int delay_time = 750;// Default delay time
-	uint8_t resolution;
-	if (all)
-		skip_rom();// Skip ROM command, will convert for ALL devices, wait maximum time
-	else {
-		match_rom(address);
-		if ((FAMILY_CODE == FAMILY_CODE_DS18B20) || (FAMILY_CODE == FAMILY_CODE_DS1822)) {
-			resolution = (uint8_t) (ram[4] & 0x60);
-			if (resolution == 0x00) // 9 bits
-				delay_time = 94;
-			if (resolution == 0x20) // 10 bits
-				delay_time = 188;
-			if (resolution == 0x40) // 11 bits.
-				delay_time = 375;
-			//Note 12bits uses the 750ms default
+bool One_wire_base::conversion_needs_pullup(rom_address_t &address, bool all) {
+	if (!_parasite_power) {
+		return false;
+	}
+	if (all) {
+		return true;
+	}
+	// a device known to have its own supply converts without the pull up on a mixed bus
+	device_info_t *device = _devices.find(to_uint64(address));
+	return device == nullptr || !device->power_cached || device->parasite_powered;
+}
+
+bool One_wire_base::conversion_ready(rom_address_t &address) {
+	uint64_t deadline = _bus_conversion_deadline;
+	uint64_t id = to_uint64(address);
+	device_info_t *device = _devices.find(id);
+	if (device != nullptr && device->conversion_deadline > deadline) {
+		deadline = device->conversion_deadline;
+	}
+	uint64_t now = time_us_64();
+	if (now < deadline) {
+		One_wire_stats::Operation operation(_stats, bus_operation_t::convert);
+		if (!conversion_polled_complete(id)) {
+			return false;
 		}
-		if (FAMILY_CODE == FAMILY_CODE_MAX31826) {
-			delay_time = 150;// 12bit conversion
+		if (_conversion_on_bus_all) {
+			_bus_conversion_deadline = now;
+			for (size_t i = 0; i < _devices.size(); i++) {
+				_devices[i].conversion_deadline = now;
+			}
+		} else if (device != nullptr) {
+			device->conversion_deadline = now;
 		}
+		_conversion_on_bus = false;
+		return _bus_conversion_deadline <= now;
 	}
+	if (_strong_pullup) {
+		// only one device might have been converting, but nothing else can use the bus
+		// until the strong pull up is dropped
+		strong_pullup(false);
+	}
+	return true;
+}
 
-	onewire_byte_out(ConvertTempCommand);// perform temperature conversion
-	if (_parasite_power) {
-		if (_power_mosfet) {
-			gpio_put(_parasite_pin, _power_polarity);// Parasite power strong pull up
-			sleep_ms(delay_time);
-			gpio_put(_parasite_pin, !_power_polarity);
-			delay_time = 0;
+bool One_wire_base::conversion_polled_complete(uint64_t id) {
+	if (!_poll_conversion || !_conversion_on_bus || _strong_pullup) {
+		return false;
+	}
+	if (!_conversion_on_bus_all && _conversion_on_bus_id != id) {
+		return false;// the bus is reporting on a different device
+	}
+	return onewire_bit_in();// devices hold the read slot low until the conversion is done
+}
+
+void One_wire_base::set_conversion_polling(bool enable) {
+	_poll_conversion = enable;
+}
+
+bool One_wire_base::collect_temperature(rom_address_t &address, float &temperature, bool convert_to_fahrenheit) {
+	if (!conversion_ready(address)) {
+		return false;
+	}
+	float answer = this->temperature(address, convert_to_fahrenheit);
+	if (answer == (float) invalid_conversion) {
+		return false;
+	}
+	temperature = answer;
+	return true;
+}
+
+int One_wire_base::convert_temperature(rom_address_t &address, bool wait, bool all) {
+	int delay_time = start_conversion(address, all);
+	if (delay_time == conversion_not_started) {
+		return delay_time;
+	}
+	if (_strong_pullup || wait) {
+		One_wire_stats::Operation operation(_stats, bus_operation_t::convert);
+		if (_poll_conversion && !_strong_pullup) {
+			while (!conversion_ready(address)) {// the polling read slots are counted as slots
+			}
 		} else {
-			gpio_set_dir(_data_pin, GPIO_OUT);
-			gpio_put(_data_pin, true);
+			uint64_t start = One_wire_stats::now();
 			sleep_ms(delay_time);
-			gpio_set_dir(_data_pin, GPIO_IN);
+			_stats.wait(start);
 		}
-	} else {
-		if (wait) {
-			sleep_ms(delay_time);
-			delay_time = 0;
+		if (_strong_pullup) {
+			strong_pullup(false);
 		}
+		delay_time = 0;
 	}
 	return delay_time;
 }
 
-void One_wire::read_scratch_pad(rom_address_t &address) {
-	int i;
-	match_rom(address);
+void One_wire_base::read_scratch_pad(rom_address_t &address) {
+	read_scratch_pad(address, ram);
+}
+
+bool One_wire_base::read_scratch_pad(rom_address_t &address, uint8_t *scratch_pad) {
+	One_wire_stats::Operation operation(_stats, bus_operation_t::read_scratch_pad);
+	if (!match_rom(address)) {
+		memset(scratch_pad, 0xFF, ScratchPadSize);// as an unanswered read
+		return false;
+	}
 	onewire_byte_out(ReadScratchPadCommand);
-	for (i = 0; i < 9; i++) {
-		ram[i] = onewire_byte_in();
+	onewire_block_in(scratch_pad, ScratchPadSize);
+	return true;
+}
+
+one_wire_status_t One_wire_base::read_scratch_pad_checked(rom_address_t &address, uint8_t *scratch_pad) {
+	// only this transaction is repeated, the rest of the caller's cycle carries on
+	device_info_t *device = _devices.find(to_uint64(address));
+	one_wire_status_t status = one_wire_status_t::ok;
+	for (unsigned int attempt = 0; attempt <= _retries; attempt++) {
+		if (attempt > 0 && _retry_delay_us != 0) {
+			sleep_us((int) _retry_delay_us);
+		}
+		if (!read_scratch_pad(address, scratch_pad)) {
+			status = one_wire_status_t::no_presence;
+			if (device != nullptr) {
+				device->presence_errors++;
+			}
+		} else if (One_wire_crc::crc8(scratch_pad, ScratchPadSize) != 0) {
+			_stats.crc_failure();
+			status = one_wire_status_t::crc_error;
+			if (device != nullptr) {
+				device->crc_errors++;
+			}
+		} else {
+			return one_wire_status_t::ok;
+		}
 	}
+	return status;
 }
 
-bool One_wire::set_resolution(rom_address_t &address, unsigned int resolution) {
-	bool answer = false;
+void One_wire_base::set_fast_read(bool enable, unsigned int full_read_interval, unsigned int max_step) {
+	_fast_read = enable;
+	_full_read_interval = full_read_interval;
+	_fast_read_max_step = max_step;
+}
+
+bool One_wire_base::fast_read_plausible(device_info_t &device, int16_t raw) const {
+	if (raw == -1) {
+		return false;// a device that dropped off reads all ones, on a shared bus the others still answer presence
+	}
+	if (raw < -55 * 16 || raw > 125 * 16) {
+		return false;// outside the sensor range
+	}
+	int step = raw - device.last_raw;
+	return step <= (int) _fast_read_max_step && -step <= (int) _fast_read_max_step;
+}
+
+one_wire_status_t One_wire_base::read_temperature_scratch_pad(rom_address_t &address, uint8_t *scratch_pad) {
+	device_info_t *device = nullptr;
+	// DS18S20 needs COUNT_REMAIN from the end of the scratch pad so is always read in full
+	if (_fast_read && FAMILY_CODE != FAMILY_CODE_DS18S20) {
+		device = _devices.add(address);
+	}
+	if (device != nullptr && device->last_raw_valid && device->reads_since_full_read < _full_read_interval) {
+		One_wire_stats::Operation operation(_stats, bus_operation_t::read_scratch_pad);
+		if (match_rom(address)) {
+			onewire_byte_out(ReadScratchPadCommand);
+			onewire_block_in(scratch_pad, 2);
+			(void) reset_check_for_device();// abandon the rest of the scratch pad
+			auto raw = (int16_t) ((scratch_pad[1] << 8) | scratch_pad[0]);
+			if (fast_read_plausible(*device, raw)) {
+				device->reads_since_full_read++;
+				device->last_raw = raw;
+				return one_wire_status_t::ok;
+			}
+		}
+		// fall through to confirm with a full CRC checked read
+	}
+
+	one_wire_status_t status = read_scratch_pad_checked(address, scratch_pad);
+	if (device != nullptr) {
+		device->reads_since_full_read = 0;
+		device->last_raw = (int16_t) ((scratch_pad[1] << 8) | scratch_pad[0]);
+		device->last_raw_valid = status == one_wire_status_t::ok;
+	}
+	return status;
+}
+
+int One_wire_base::read_all(bus_readings_t &readings) {
+	rom_address_t address{};
+	size_t count = _devices.size() < readings.capacity ? _devices.size() : readings.capacity;
+	convert_temperature(address, true, true);// one conversion for the whole bus
+	for (size_t i = 0; i < count; i++) {
+		read_into(readings, i);
+	}
+	readings.count = count;
+	return (int) count;
+}
+
+void One_wire_base::read_into(bus_readings_t &readings, size_t index) {
+	uint8_t scratch_pad[ScratchPadSize];
+	device_info_t &device = _devices[index];
+	readings.crc_ok[index] = read_temperature_scratch_pad(device.address, scratch_pad) == one_wire_status_t::ok;
+	readings.ids[index] = device.id;
+	readings.raw[index] = (int16_t) ((scratch_pad[1] << 8) | scratch_pad[0]);
+	readings.timestamps[index] = time_us_64();
+}
+
+int One_wire_base::read_all_staggered(bus_readings_t &readings) {
+	size_t count = _devices.size() < readings.capacity ? _devices.size() : readings.capacity;
+	readings.count = count;
+	if (count == 0) {
+		return 0;
+	}
+	bool needs_pullup = false;
+	int slowest = 0;
+	for (size_t i = 0; i < count; i++) {
+		device_info_t &device = _devices[i];
+		if (!device.config_cached || !device.power_cached) {
+			(void) read_device_config(device.address);
+		}
+		needs_pullup = needs_pullup || (_parasite_power && (!device.power_cached || device.parasite_powered));
+		int time = conversion_time(device.address, &device);
+		slowest = time > slowest ? time : slowest;
+	}
+
+	// one conversion starts every resolution group at once, each finishes in its own time
+	uint64_t start;
+	{
+		One_wire_stats::Operation operation(_stats, bus_operation_t::convert);
+		if (skip_rom()) {
+			onewire_byte_out(ConvertTempCommand);
+		}
+		start = time_us_64();
+		for (size_t i = 0; i < count; i++) {
+			_devices[i].conversion_deadline = start + (uint64_t) conversion_time(_devices[i].address, &_devices[i]) * 1000;
+		}
+		if (needs_pullup) {
+			// nothing else can use the bus while the pull up is on, so wait for the slowest group
+			strong_pullup(true);
+			uint64_t wait_start = One_wire_stats::now();
+			sleep_ms(slowest);
+			_stats.wait(wait_start);
+			strong_pullup(false);
+		}
+	}
+	_conversion_on_bus = false;
+
+	// read the groups fastest first, the slow ones are still converting meanwhile
+	int group_time = 0;
+	while (group_time < slowest) {
+		int next_time = slowest;
+		for (size_t i = 0; i < count; i++) {
+			int time = conversion_time(_devices[i].address, &_devices[i]);
+			if (time > group_time && time < next_time) {
+				next_time = time;
+			}
+		}
+		uint64_t deadline = start + (uint64_t) next_time * 1000;
+		uint64_t now = time_us_64();
+		if (deadline > now) {
+			One_wire_stats::Operation operation(_stats, bus_operation_t::convert);
+			uint64_t wait_start = One_wire_stats::now();
+			sleep_us((int) (deadline - now));
+			_stats.wait(wait_start);
+		}
+		for (size_t i = 0; i < count; i++) {
+			if (conversion_time(_devices[i].address, &_devices[i]) == next_time) {
+				read_into(readings, i);
+			}
+		}
+		group_time = next_time;
+	}
+	return (int) count;
+}
+
+bool One_wire_base::set_resolution(rom_address_t &address, unsigned int resolution) {
+	device_info_t uncached;
+	device_info_t *device;
 	switch (FAMILY_CODE) {
 		case FAMILY_CODE_DS18B20:
 		case FAMILY_CODE_DS18S20:
 		case FAMILY_CODE_DS1822:
-			resolution = resolution - 9;
-			if (resolution < 4) {
-				resolution = resolution << 5;                    // align the bits
-				ram[4] = (uint8_t) ((ram[4] & 0x60) | resolution);// mask out old data, insert new
-				write_scratch_pad(address, (ram[2] << 8) + ram[3]);
-				answer = true;
-			}
 			break;
 		default:
+			return false;
+	}
+	if (resolution < 9 || resolution > 12) {
+		return false;
+	}
+	if ((device = configured_device(address, uncached)) == nullptr) {
+		return false;
+	}
+	// reserved bits 0-4 read as ones, bits 5 and 6 select the resolution
+	auto config = (uint8_t) (0x1F | ((resolution - 9) << 5));
+	write_scratch_pad(address, (uint8_t) device->alarm_high, (uint8_t) device->alarm_low, config);
+	if (FAMILY_CODE != FAMILY_CODE_DS18S20) {
+		device->resolution = (uint8_t) resolution;
+	}
+	return true;
+}
+
+bool One_wire_base::set_alarm_thresholds(rom_address_t &address, int8_t high, int8_t low, bool persist) {
+	device_info_t uncached;
+	device_info_t *device;
+	switch (FAMILY_CODE) {
+		case FAMILY_CODE_DS18B20:
+		case FAMILY_CODE_DS18S20:
+		case FAMILY_CODE_DS1822:
 			break;
+		default:
+			return false;
 	}
-	return answer;
+	if ((device = configured_device(address, uncached)) == nullptr) {
+		return false;
+	}
+	// the configuration register is written back unchanged
+	write_scratch_pad(address, (uint8_t) high, (uint8_t) low, (uint8_t) (0x1F | ((device->resolution - 9) << 5)));
+	device->alarm_high = high;
+	device->alarm_low = low;
+	if (persist) {
+		copy_scratch_pad(address);
+	}
+	return true;
+}
+
+bool One_wire_base::read_device_config(rom_address_t &address) {
+	device_info_t *device = _devices.add(address);
+	if (device == nullptr || configured_device(address, *device) == nullptr) {
+		return false;
+	}
+	if (!device->power_cached) {
+		device->parasite_powered = !power_supply_available(address, false);
+		device->power_cached = true;
+	}
+	return true;
+}
+
+device_info_t *One_wire_base::configured_device(rom_address_t &address, device_info_t &uncached) {
+	uint8_t scratch_pad[ScratchPadSize];
+	device_info_t *device = _devices.add(address);
+	if (device == nullptr) {
+		uncached = device_info_t{};// registry full, use the caller's entry for this call only
+		device = &uncached;
+	}
+	if (device->config_cached) {
+		return device;
+	}
+	if (read_scratch_pad_checked(address, scratch_pad) != one_wire_status_t::ok) {
+		return nullptr;
+	}
+	device->alarm_high = (int8_t) scratch_pad[2];
+	device->alarm_low = (int8_t) scratch_pad[3];
+	if ((FAMILY_CODE == FAMILY_CODE_DS18B20) || (FAMILY_CODE == FAMILY_CODE_DS1822)) {
+		device->resolution = (uint8_t) (9 + ((scratch_pad[4] >> 5) & 0x03));
+	} else if (FAMILY_CODE == FAMILY_CODE_MAX31826) {
+		device->resolution = 12;
+	} else {
+		device->resolution = 9;
+	}
+	device->config_cached = true;
+	return device;
 }
 
-void One_wire::write_scratch_pad(rom_address_t &address, int data) {
-	ram[3] = (uint8_t) data;
-	ram[2] = (uint8_t) (data >> 8);
+void One_wire_base::copy_scratch_pad(rom_address_t &address) {
+	One_wire_stats::Operation operation(_stats, bus_operation_t::write_scratch_pad);
+	match_rom(address);
+	onewire_byte_out(CopyScratchPadCommand);
+	powered_wait(10);// EEPROM write
+}
+
+void One_wire_base::powered_wait(unsigned int ms) {
+	uint64_t start = One_wire_stats::now();
+	if (_parasite_power) {
+		strong_pullup(true);
+		sleep_ms((int) ms);
+		strong_pullup(false);
+	} else {
+		sleep_ms((int) ms);
+	}
+	_stats.wait(start);
+}
+
+void One_wire_base::write_scratch_pad(rom_address_t &address, uint8_t high, uint8_t low, uint8_t config) {
+	One_wire_stats::Operation operation(_stats, bus_operation_t::write_scratch_pad);
 	match_rom(address);
 	onewire_byte_out(WriteScratchPadCommand);
-	onewire_byte_out(ram[2]);// T(H)
-	onewire_byte_out(ram[3]);// T(L)
-	if ((FAMILY_CODE == FAMILY_CODE_DS18S20) || (FAMILY_CODE == FAMILY_CODE_DS18B20) ||
-		(FAMILY_CODE == FAMILY_CODE_DS1822)) {
-		onewire_byte_out(ram[4]);// Configuration register
+	onewire_byte_out(high);// T(H)
+	onewire_byte_out(low); // T(L)
+	if ((FAMILY_CODE == FAMILY_CODE_DS18B20) || (FAMILY_CODE == FAMILY_CODE_DS1822)) {
+		onewire_byte_out(config);// Configuration register
 	}
 }
 
-uint64_t One_wire::to_uint64(rom_address_t &address) {
+uint64_t One_wire_base::to_uint64(rom_address_t &address) {
         return  ((uint64_t)address.rom[7])        |
                (((uint64_t)address.rom[6]) << 8 ) |
                (((uint64_t)address.rom[5]) << 16) |
@@ -406,46 +1008,78 @@ uint64_t One_wire::to_uint64(rom_address_t &address) {
                (((uint64_t)address.rom[0]) << 56);
 }
 
-float One_wire::temperature(rom_address_t &address, bool convert_to_fahrenheit) {
-	float answer, remaining_count, count_per_degree;
-	int reading;
-	read_scratch_pad(address);
-	if (ram_checksum_error())
-		// Indicate we got a CRC error
+float One_wire_base::temperature(rom_address_t &address, bool convert_to_fahrenheit) {
+	float answer;
+	if (read_temperature(address, answer, convert_to_fahrenheit) != one_wire_status_t::ok) {
+		// Indicate we got a CRC error (or no answer, or not a thermometer)
 		answer = invalid_conversion;
-	else {
-		reading = (ram[1] << 8) + ram[0];
-		if (reading & 0x8000) {                    // negative degrees C
-			reading = 0 - ((reading ^ 0xffff) + 1);// 2's comp then convert to signed int
-		}
+	}
+	return answer;
+}
 
-		answer = (float) reading;
-
-		switch (FAMILY_CODE) {
-			case FAMILY_CODE_MAX31826:
-			case FAMILY_CODE_DS18B20:
-			case FAMILY_CODE_DS1822:
-				answer = answer / 16.0f;
-				break;
-			case FAMILY_CODE_DS18S20:
-				remaining_count = ram[6];
-				count_per_degree = ram[7];
-				answer = (float) (std::floor(answer / 2.0f) - 0.25f +
-								  (count_per_degree - remaining_count) / count_per_degree);
-				break;
-			default:
-				printf("Unsupported device family\n");
-				break;
-		}
+one_wire_status_t One_wire_base::read_temperature(rom_address_t &address, float &temperature, bool convert_to_fahrenheit) {
+	int32_t sixteenths;
+	one_wire_status_t status = read_temperature_fixed(address, sixteenths);
+	if (status != one_wire_status_t::ok) {
+		return status;
+	}
+	float answer = (float) sixteenths / 16.0f;// exact, every family resolves to a 1/16 degC step
+	if (convert_to_fahrenheit) {
+		answer = answer * 9.0f / 5.0f + 32.0f;
+	}
+	temperature = answer;
+	return one_wire_status_t::ok;
+}
 
-		if (convert_to_fahrenheit) {
-			answer = answer * 9.0f / 5.0f + 32.0f;
-		}
+one_wire_status_t One_wire_base::read_temperature_fixed(rom_address_t &address, int32_t &sixteenths, bool convert_to_fahrenheit) {
+	switch (FAMILY_CODE) {
+		case FAMILY_CODE_MAX31826:
+		case FAMILY_CODE_DS18B20:
+		case FAMILY_CODE_DS1822:
+		case FAMILY_CODE_DS18S20:
+			break;
+		default:
+			return one_wire_status_t::unsupported_device;
 	}
-	return answer;
+	one_wire_status_t status = read_temperature_scratch_pad(address, ram);
+	if (status != one_wire_status_t::ok) {
+		return status;
+	}
+	int32_t answer = scratch_pad_to_fixed(FAMILY_CODE, ram);
+	sixteenths = convert_to_fahrenheit ? fixed_to_fahrenheit(answer) : answer;
+	return one_wire_status_t::ok;
+}
+
+int32_t One_wire_base::scratch_pad_to_fixed(uint8_t family, const uint8_t *scratch_pad) {
+	auto reading = (int16_t) ((scratch_pad[1] << 8) | scratch_pad[0]);
+	if (family != FAMILY_CODE_DS18S20) {
+		return reading;// already in 1/16 degC
+	}
+	// DS18S20 extended resolution: TEMP_READ - 0.25 + (COUNT_PER_C - COUNT_REMAIN) / COUNT_PER_C,
+	// TEMP_READ being the half degree reading truncated to whole degrees
+	int32_t count_remain = scratch_pad[6];
+	int32_t count_per_degree = scratch_pad[7];
+	int32_t whole = reading >= 0 ? reading / 2 : -((1 - reading) / 2);
+	if (count_per_degree == 0) {
+		return reading * 8;// no extended resolution, half degrees
+	}
+	return whole * 16 - 4 + (count_per_degree - count_remain) * 16 / count_per_degree;
+}
+
+int32_t One_wire_base::fixed_to_fahrenheit(int32_t sixteenths) {
+	// F = C * 9 / 5 + 32, rounded to the nearest 1/16
+	int32_t scaled = sixteenths * 9;
+	scaled = (scaled >= 0 ? scaled + 2 : scaled - 2) / 5;
+	return scaled + 32 * 16;
+}
+
+int32_t One_wire_base::fixed_to_milli(int32_t sixteenths) {
+	// 1000 / 16 = 125 / 2, rounded to the nearest thousandth
+	int32_t scaled = sixteenths * 125;
+	return (scaled >= 0 ? scaled + 1 : scaled - 1) / 2;
 }
 
-bool One_wire::power_supply_available(rom_address_t &address, bool all) {
+bool One_wire_base::power_supply_available(rom_address_t &address, bool all) {
 	if (all) {
 		skip_rom();
 	} else {
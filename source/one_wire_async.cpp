@@ -0,0 +1,208 @@
+#include "../api/one_wire_async.h"
+
+#ifdef MOCK_PICO_PI
+
+#include "../test/pico_pi_mocks.h"
+
+#else
+
+#include "hardware/gpio.h"
+
+#endif
+
+One_wire_async::One_wire_async(One_wire_base &bus)
+		: _bus(bus) {
+}
+
+One_wire_async::~One_wire_async() {
+	cancel();
+}
+
+bool One_wire_async::start_read_all(bus_readings_t &readings, done_callback_t done, void *user_data) {
+	if (busy()) {
+		return false;
+	}
+	_readings = &readings;
+	_done = done;
+	_user_data = user_data;
+	_count = _bus._devices.size() < readings.capacity ? _bus._devices.size() : readings.capacity;
+	_bus._conversion_on_bus = false;
+	_busy.store(true, std::memory_order_release);
+	begin_reset(state_t::convert);
+	uint32_t wait = advance();
+	if (wait == 0) {
+		return true;// finished without waiting, e.g. on the PIO engine with nobody present
+	}
+	_alarm = add_alarm_in_us(wait, alarm_callback, this, true);
+	if (_alarm < 0) {
+		cancel();
+		return false;
+	}
+	return true;
+}
+
+void One_wire_async::cancel() {
+	if (!busy()) {
+		return;
+	}
+	cancel_alarm(_alarm);
+	if (_bus._strong_pullup) {
+		_bus.strong_pullup(false);
+	}
+	if (!_bus._pio_engine.active()) {
+		gpio_set_dir(_bus._data_pin, GPIO_IN);
+	}
+	_state = state_t::idle;
+	_busy.store(false, std::memory_order_release);
+}
+
+int64_t One_wire_async::alarm_callback(alarm_id_t id, void *user_data) {
+	auto *self = (One_wire_async *) user_data;
+	uint32_t wait = self->advance();
+	// positive reschedules relative to now, so every wait is at least as long as asked
+	return (int64_t) wait;
+}
+
+uint32_t One_wire_async::advance() {
+	// run states until one has to wait, 0 once the read is complete
+	while (_state != state_t::idle) {
+		uint32_t wait = run_state();
+		if (wait != 0) {
+			return wait;
+		}
+	}
+	return 0;
+}
+
+void One_wire_async::begin_reset(state_t next) {
+	_after_reset = next;
+	_state = state_t::reset_low;
+}
+
+void One_wire_async::begin_transfer(size_t out_length, size_t in_length, state_t next) {
+	_out_length = out_length;
+	_in_length = in_length;
+	_transferred = 0;
+	_after_transfer = next;
+	_state = state_t::transfer;
+}
+
+uint32_t One_wire_async::run_state() {
+	const slot_timing_t &timing = *_bus._timing;
+	Data_pin_port port{_bus._data_pin};
+
+	switch (_state) {
+		case state_t::reset_low:
+			if (_bus._pio_engine.active()) {
+				// the state machine times the whole reset itself
+				_presence = _bus._pio_engine.reset();
+				_state = _after_reset;
+				return 0;
+			}
+			gpio_init(_bus._data_pin);
+			port.drive_low(1);
+			_state = state_t::reset_release;
+			return timing.reset_low;
+
+		case state_t::reset_release:
+			_released = time_us_32();
+			port.release(1);
+			_state = state_t::presence_sample;
+			return timing.presence_sample > presence_lead_us ? timing.presence_sample - presence_lead_us : 0;
+
+		case state_t::presence_sample:
+			// the alarm comes back a little early, busy wait the rest to keep the sample point exact
+			onewire_wait_until(_released + timing.presence_sample);
+			_presence = port.sample() == 0;
+			_state = _after_reset;
+			return timing.reset_recovery;
+
+		case state_t::convert:
+			if (!_presence) {
+				finish(0);
+				return 0;
+			}
+			_out[0] = SkipROMCommand;
+			_out[1] = ConvertTempCommand;
+			begin_transfer(2, 0, state_t::conversion_start);
+			return 0;
+
+		case state_t::conversion_start:
+			if (_bus._parasite_power) {
+				_bus.strong_pullup(true);
+			}
+			_state = state_t::conversion_done;
+			{
+				rom_address_t address{};
+				return (uint32_t) _bus.conversion_delay(address, true) * 1000;
+			}
+
+		case state_t::conversion_done:
+			if (_bus._strong_pullup) {
+				_bus.strong_pullup(false);
+			}
+			_device = 0;
+			if (_count == 0) {
+				finish(0);
+				return 0;
+			}
+			begin_reset(state_t::select_device);
+			return 0;
+
+		case state_t::select_device: {
+			if (!_presence) {
+				_in[0] = _in[1] = 0;
+				_in[ScratchPadSize - 1] = 1;// fails the CRC
+				_state = state_t::store_reading;
+				return 0;
+			}
+			device_info_t &device = _bus._devices[_device];
+			_out[0] = MatchROMCommand;
+			for (size_t i = 0; i < ROMSize; i++) {
+				_out[1 + i] = device.address.rom[i];
+			}
+			_out[1 + ROMSize] = ReadScratchPadCommand;
+			begin_transfer(max_out, ScratchPadSize, state_t::store_reading);
+			return 0;
+		}
+
+		case state_t::transfer:
+			if (_transferred < _out_length) {
+				_bus.onewire_byte_out(_out[_transferred]);
+			} else if (_transferred < _out_length + _in_length) {
+				_in[_transferred - _out_length] = _bus.onewire_byte_in();
+			} else {
+				_state = _after_transfer;
+				return 0;
+			}
+			_transferred++;
+			return byte_gap_us;
+
+		case state_t::store_reading: {
+			device_info_t &device = _bus._devices[_device];
+			_readings->ids[_device] = device.id;
+			_readings->raw[_device] = (int16_t) ((_in[1] << 8) | _in[0]);
+			_readings->crc_ok[_device] = _presence && One_wire_crc::crc8(_in, ScratchPadSize) == 0;
+			_readings->timestamps[_device] = time_us_64();
+			if (++_device < _count) {
+				begin_reset(state_t::select_device);
+			} else {
+				finish(_count);
+			}
+			return 0;
+		}
+
+		case state_t::idle:
+		default:
+			return 0;
+	}
+}
+
+void One_wire_async::finish(size_t count) {
+	_readings->count = count;
+	_state = state_t::idle;
+	_busy.store(false, std::memory_order_release);
+	if (_done != nullptr) {
+		_done(*_readings, _user_data);
+	}
+}
@@ -0,0 +1,183 @@
+#include "../api/one_wire_memory.h"
+#include <cstring>
+
+One_wire_memory::One_wire_memory(One_wire_base &bus)
+		: _bus(bus) {
+}
+
+bool One_wire_memory::supported(uint8_t family) {
+	return family == FAMILY_CODE_DS2502 || family == FAMILY_CODE_MAX31826;
+}
+
+one_wire_status_t One_wire_memory::read(rom_address_t &address, size_t offset, uint8_t *data, size_t length) {
+	if (!supported(FAMILY_CODE) || offset > memory_size || length > memory_size - offset) {
+		return one_wire_status_t::unsupported_device;
+	}
+	if (length == 0) {
+		return one_wire_status_t::ok;
+	}
+	if (FAMILY_CODE == FAMILY_CODE_DS2502) {
+		return read_with_crc(address, offset, data, length);
+	}
+	return read_twice(address, offset, data, length);
+}
+
+one_wire_status_t One_wire_memory::read_with_crc(rom_address_t &address, size_t offset, uint8_t *data, size_t length) {
+	const uint8_t command[] = {ReadDataCRCCommand, (uint8_t) offset, (uint8_t) (offset >> 8)};
+	uint8_t crc;
+	if (_bus.transaction(&address, command, sizeof(command), &crc, 1) != one_wire_status_t::ok) {
+		return one_wire_status_t::no_presence;
+	}
+	if (One_wire_crc::crc8(command, sizeof(command)) != crc) {
+		return one_wire_status_t::crc_error;
+	}
+	size_t end = offset + length;
+	while (offset < end) {
+		// each page is followed by the CRC8 of the bytes read from it
+		size_t page_end = (offset / page_size + 1) * page_size;
+		size_t count = (end < page_end ? end : page_end) - offset;
+		_bus.read(data, count);
+		uint8_t page_crc = One_wire_crc::crc8(data, count);
+		if (offset + count < page_end) {
+			uint8_t rest[page_size];
+			size_t rest_length = page_end - offset - count;
+			_bus.read(rest, rest_length);
+			page_crc = One_wire_crc::crc8(rest, rest_length, page_crc);
+		}
+		_bus.read(&crc, 1);
+		if (crc != page_crc) {
+			return one_wire_status_t::crc_error;
+		}
+		data += count;
+		offset += count;
+	}
+	return one_wire_status_t::ok;
+}
+
+one_wire_status_t One_wire_memory::read_twice(rom_address_t &address, size_t offset, uint8_t *data, size_t length) {
+	const uint8_t command[] = {ReadMemoryCommand, (uint8_t) offset};
+	if (_bus.transaction(&address, command, sizeof(command), data, length) != one_wire_status_t::ok) {
+		return one_wire_status_t::no_presence;
+	}
+	// the MAX31826 sends no CRC with its memory, the second read must agree
+	if (!_bus.select(address)) {
+		return one_wire_status_t::no_presence;
+	}
+	_bus.write(command, sizeof(command));
+	for (size_t i = 0; i < length; i += page_size) {
+		uint8_t check[page_size];
+		size_t count = length - i < page_size ? length - i : page_size;
+		_bus.read(check, count);
+		if (memcmp(check, data + i, count) != 0) {
+			return one_wire_status_t::crc_error;
+		}
+	}
+	return one_wire_status_t::ok;
+}
+
+one_wire_status_t One_wire_memory::read_page(rom_address_t &address, size_t page, uint8_t *data) {
+	if (page >= memory_size / page_size) {
+		return one_wire_status_t::unsupported_device;
+	}
+	uint64_t id = One_wire::to_uint64(address);
+	for (cached_page_t &cached : _cache) {
+		if (cached.valid && cached.id == id && cached.page == page) {
+			memcpy(data, cached.data, page_size);
+			_cache_hits++;
+			return one_wire_status_t::ok;
+		}
+	}
+	cached_page_t &cached = _cache[_next_victim];
+	cached.valid = false;
+	one_wire_status_t status = read(address, page * page_size, cached.data, page_size);
+	if (status != one_wire_status_t::ok) {
+		return status;
+	}
+	cached.id = id;
+	cached.page = page;
+	cached.valid = true;
+	_next_victim = (_next_victim + 1) % ONE_WIRE_MEMORY_CACHE_PAGES;
+	memcpy(data, cached.data, page_size);
+	return one_wire_status_t::ok;
+}
+
+one_wire_status_t One_wire_memory::write(rom_address_t &address, size_t offset, const uint8_t *data, size_t length) {
+	if (FAMILY_CODE != FAMILY_CODE_MAX31826 || offset > memory_size || length > memory_size - offset) {
+		return one_wire_status_t::unsupported_device;
+	}
+	if (length == 0) {
+		return one_wire_status_t::ok;
+	}
+	size_t end = offset + length;
+	invalidate(One_wire::to_uint64(address), offset / page_size, (end - 1) / page_size);
+	for (size_t block = offset / block_size; block <= (end - 1) / block_size; block++) {
+		size_t block_start = block * block_size;
+		uint8_t block_data[block_size];
+		if (offset > block_start || end < block_start + block_size) {
+			// keep the bytes of the block that aren't being written
+			one_wire_status_t status = read(address, block_start, block_data, block_size);
+			if (status != one_wire_status_t::ok) {
+				return status;
+			}
+		}
+		for (size_t i = 0; i < block_size; i++) {
+			if (block_start + i >= offset && block_start + i < end) {
+				block_data[i] = data[block_start + i - offset];
+			}
+		}
+		one_wire_status_t status = write_block(address, block, block_data);
+		if (status != one_wire_status_t::ok) {
+			return status;
+		}
+	}
+	for (size_t i = 0; i < length; i += page_size) {
+		uint8_t check[page_size];
+		size_t count = length - i < page_size ? length - i : page_size;
+		one_wire_status_t status = read(address, offset + i, check, count);
+		if (status != one_wire_status_t::ok) {
+			return status;
+		}
+		if (memcmp(check, data + i, count) != 0) {
+			return one_wire_status_t::crc_error;
+		}
+	}
+	return one_wire_status_t::ok;
+}
+
+one_wire_status_t One_wire_memory::write_block(rom_address_t &address, size_t block, const uint8_t *data) {
+	uint8_t command[2 + block_size] = {WriteScratchPad2Command, (uint8_t) (block * block_size)};
+	memcpy(&command[2], data, block_size);
+	if (_bus.transaction(&address, command, sizeof(command)) != one_wire_status_t::ok) {
+		return one_wire_status_t::no_presence;
+	}
+	// check the scratch pad before it is committed to the EEPROM
+	const uint8_t read_command[] = {ReadScratchPad2Command};
+	uint8_t scratch_pad[block_size + 1];
+	if (_bus.transaction(&address, read_command, sizeof(read_command), scratch_pad, sizeof(scratch_pad)) != one_wire_status_t::ok) {
+		return one_wire_status_t::no_presence;
+	}
+	if (One_wire_crc::crc8(scratch_pad, block_size) != scratch_pad[block_size] ||
+		memcmp(scratch_pad, data, block_size) != 0) {
+		return one_wire_status_t::crc_error;
+	}
+	const uint8_t copy_command[] = {CopyScratchPad2Command, CopyScratchPad2Validation};
+	if (_bus.transaction(&address, copy_command, sizeof(copy_command)) != one_wire_status_t::ok) {
+		return one_wire_status_t::no_presence;
+	}
+	_bus.powered_wait(25);// EEPROM write
+	return one_wire_status_t::ok;
+}
+
+void One_wire_memory::invalidate() {
+	for (cached_page_t &cached : _cache) {
+		cached.valid = false;
+	}
+}
+
+void One_wire_memory::invalidate(uint64_t id, size_t first_page, size_t last_page) {
+	for (cached_page_t &cached : _cache) {
+		if (cached.valid && cached.id == id && cached.page >= first_page && cached.page <= last_page) {
+			cached.valid = false;
+		}
+	}
+}
@@ -0,0 +1,138 @@
+#include "../api/one_wire_multi.h"
+
+#ifdef MOCK_PICO_PI
+
+#include "../test/pico_pi_mocks.h"
+
+#else
+
+#include "hardware/gpio.h"
+
+#endif
+
+One_wire_multi::One_wire_multi(const uint *data_pins, size_t bus_count)
+		: _bus_count(bus_count < max_buses ? bus_count : max_buses) {
+	for (size_t i = 0; i < _bus_count; i++) {
+		_pins[i] = data_pins[i];
+		_pin_mask |= 1u << data_pins[i];
+	}
+}
+
+void One_wire_multi::init() {
+	for (size_t i = 0; i < _bus_count; i++) {
+		gpio_init(_pins[i]);
+	}
+	skip_rom();
+	byte_out(ReadPowerSupplyCommand);
+	// parasite powered devices pull the read slot low
+	_parasite_buses = to_bus_mask(~onewire_read_slot(Masked_pins_port{}, *_timing, _pin_mask) & _pin_mask);
+}
+
+uint32_t One_wire_multi::to_bus_mask(uint32_t pins) const {
+	uint32_t buses = 0;
+	for (size_t i = 0; i < _bus_count; i++) {
+		if (pins & (1u << _pins[i])) {
+			buses |= 1u << i;
+		}
+	}
+	return buses;
+}
+
+uint32_t One_wire_multi::to_pin_mask(uint32_t buses) const {
+	uint32_t pins = 0;
+	for (size_t i = 0; i < _bus_count; i++) {
+		if (buses & (1u << i)) {
+			pins |= 1u << _pins[i];
+		}
+	}
+	return pins;
+}
+
+uint32_t One_wire_multi::reset() {
+	return to_bus_mask(onewire_reset_slot(Masked_pins_port{}, *_timing, _pin_mask));
+}
+
+uint32_t One_wire_multi::skip_rom() {
+	uint32_t present = reset();
+	byte_out(SkipROMCommand);
+	return present;
+}
+
+uint32_t One_wire_multi::match_rom(const rom_address_t *addresses) {
+	uint8_t data[max_buses];
+	uint32_t present = reset();
+	byte_out(MatchROMCommand);
+	for (int byte = 0; byte < ROMSize; byte++) {
+		for (size_t i = 0; i < _bus_count; i++) {
+			data[i] = addresses[i].rom[byte];
+		}
+		bytes_out(data);
+	}
+	return present;
+}
+
+void One_wire_multi::byte_out(uint8_t data) {
+	for (int bit = 0; bit < 8; bit++) {
+		onewire_write_slot(Masked_pins_port{}, *_timing, _pin_mask, (data & 0x01) ? _pin_mask : 0);
+		data = data >> 1;
+	}
+}
+
+void One_wire_multi::bytes_out(const uint8_t *data) {
+	for (int bit = 0; bit < 8; bit++) {
+		uint32_t ones = 0;
+		for (size_t i = 0; i < _bus_count; i++) {
+			if (data[i] & (1u << bit)) {
+				ones |= 1u << _pins[i];
+			}
+		}
+		onewire_write_slot(Masked_pins_port{}, *_timing, _pin_mask, ones);
+	}
+}
+
+void One_wire_multi::block_in(uint8_t *data, size_t length) {
+	for (size_t byte = 0; byte < length; byte++) {
+		for (size_t i = 0; i < _bus_count; i++) {
+			data[i * length + byte] = 0;
+		}
+		for (int bit = 0; bit < 8; bit++) {
+			uint32_t pins = onewire_read_slot(Masked_pins_port{}, *_timing, _pin_mask);
+			for (size_t i = 0; i < _bus_count; i++) {
+				if (pins & (1u << _pins[i])) {
+					data[i * length + byte] |= (uint8_t) (1u << bit);
+				}
+			}
+		}
+	}
+}
+
+uint32_t One_wire_multi::convert_temperature(bool wait) {
+	uint32_t present = skip_rom();
+	byte_out(ConvertTempCommand);
+	uint32_t pullup = to_pin_mask(_parasite_buses);
+	if (pullup != 0) {
+		// strong pull up for the parasite powered buses until the conversion completes
+		gpio_put_masked(pullup, pullup);
+		gpio_set_dir_masked(pullup, pullup);
+	}
+	if (wait || pullup != 0) {
+		sleep_ms(750);
+	}
+	if (pullup != 0) {
+		gpio_set_dir_masked(pullup, 0);
+	}
+	return present;
+}
+
+uint32_t One_wire_multi::read_scratch_pads(uint8_t (*scratch_pads)[ScratchPadSize], const rom_address_t *addresses) {
+	uint32_t present = addresses == nullptr ? skip_rom() : match_rom(addresses);
+	byte_out(ReadScratchPadCommand);
+	block_in(&scratch_pads[0][0], ScratchPadSize);
+	uint32_t valid = 0;
+	for (size_t i = 0; i < _bus_count; i++) {
+		if ((present & (1u << i)) && One_wire_crc::crc8(scratch_pads[i], ScratchPadSize) == 0) {
+			valid |= 1u << i;
+		}
+	}
+	return valid;
+}
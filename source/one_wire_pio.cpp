@@ -0,0 +1,117 @@
+#include "../api/one_wire_pio.h"
+
+#ifdef MOCK_PICO_PI
+
+#include "../test/pico_pi_mocks.h"
+
+#else
+
+#include "hardware/clocks.h"
+#include "one_wire.pio.h"
+
+#endif
+
+One_wire_pio::One_wire_pio(uint data_pin)
+		: _data_pin(data_pin) {
+}
+
+One_wire_pio::~One_wire_pio() {
+	deinit();
+}
+
+bool One_wire_pio::init(PIO pio) {
+	deinit();
+	if (!pio_can_add_program(pio, &onewire_program)) {
+		return false;
+	}
+	int sm = pio_claim_unused_sm(pio, false);
+	if (sm < 0) {
+		return false;
+	}
+	_sm = (uint) sm;
+	_offset = pio_add_program(pio, &onewire_program);
+	// one state machine cycle per microsecond
+	_clkdiv = (float) clock_get_hz(clk_sys) / 1000000.0f;
+	onewire_program_init(pio, _sm, _offset, _data_pin, _clkdiv);
+	_pio = pio;
+	return true;
+}
+
+void One_wire_pio::deinit() {
+	if (_pio == nullptr) {
+		return;
+	}
+	pio_sm_set_enabled(_pio, _sm, false);
+	pio_remove_program(_pio, &onewire_program, _offset);
+	pio_sm_unclaim(_pio, _sm);
+	_pio = nullptr;
+}
+
+bool One_wire_pio::reset() const {
+	pio_sm_exec(_pio, _sm, pio_encode_jmp(_offset + onewire_offset_reset));
+	// presence is the bus being held low when sampled
+	return (pio_sm_get_blocking(_pio, _sm) & 0x80000000u) == 0;
+}
+
+uint32_t One_wire_pio::transfer(uint32_t bits, uint count, bool read) const {
+	pio_sm_put_blocking(_pio, _sm, (count - 1) | (bits << 8) | (read ? read_marker : 0));
+	return pio_sm_get_blocking(_pio, _sm) >> (32 - count);
+}
+
+void One_wire_pio::bit_out(bool bit_data) const {
+	(void) transfer(bit_data, 1, false);
+}
+
+bool One_wire_pio::bit_in() const {
+	return transfer(1, 1, true) != 0;
+}
+
+void One_wire_pio::byte_out(uint8_t data) const {
+	(void) transfer(data, 8, false);
+}
+
+uint8_t One_wire_pio::byte_in() const {
+	return (uint8_t) transfer(0xFF, 8, true);
+}
+
+void One_wire_pio::block_out(const uint8_t *data, size_t length) const {
+	block_transfer(data, nullptr, length);
+}
+
+void One_wire_pio::block_in(uint8_t *data, size_t length) const {
+	block_transfer(nullptr, data, length);
+}
+
+void One_wire_pio::block_transfer(const uint8_t *out, uint8_t *in, size_t length) const {
+	size_t sent = 0;
+	size_t received = 0;
+	while (received < length) {
+		// keep up to a FIFO's worth of bytes in flight so the slots run back to back
+		if (sent < length && sent - received < fifo_depth) {
+			uint32_t data = out ? out[sent] : 0xFF;
+			pio_sm_put_blocking(_pio, _sm, 7 | (data << 8) | (out ? 0 : read_marker));
+			sent++;
+		} else {
+			uint32_t answer = pio_sm_get_blocking(_pio, _sm);
+			if (in) {
+				in[received] = (uint8_t) (answer >> 24);
+			}
+			received++;
+		}
+	}
+}
+
+void One_wire_pio::strong_pullup(bool enable) const {
+	uint32_t mask = 1u << _data_pin;
+	if (enable) {
+		pio_sm_set_pins_with_mask(_pio, _sm, mask, mask);
+		pio_sm_set_pindirs_with_mask(_pio, _sm, mask, mask);
+	} else {
+		pio_sm_set_pindirs_with_mask(_pio, _sm, 0, mask);
+		pio_sm_set_pins_with_mask(_pio, _sm, 0, mask);
+	}
+}
+
+void One_wire_pio::set_overdrive(bool enable) const {
+	pio_sm_set_clkdiv(_pio, _sm, enable ? _clkdiv / overdrive_speedup : _clkdiv);
+}
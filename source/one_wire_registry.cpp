@@ -0,0 +1,77 @@
+#include "../api/one_wire_registry.h"
+
+static uint64_t address_id(const rom_address_t &address) {
+	uint64_t id = 0;
+	for (uint8_t byte : address.rom) {
+		id = (id << 8) | byte;
+	}
+	return id;
+}
+
+size_t Device_registry_base::home_slot(uint64_t id) const {
+	// Fibonacci hashing, the top bits are well mixed even though the family code
+	// is shared by most devices on a bus
+	return (size_t) ((id * 0x9E3779B97F4A7C15ull) >> 32) & _slot_mask;
+}
+
+void Device_registry_base::index_entry(size_t index) {
+	size_t slot = home_slot(_entries[index].id);
+	while (_slots[slot] >= 0) {
+		slot = (slot + 1) & _slot_mask;
+	}
+	_slots[slot] = (int16_t) index;
+}
+
+device_info_t *Device_registry_base::find(uint64_t id) {
+	size_t slot = home_slot(id);
+	while (_slots[slot] >= 0) {
+		device_info_t &entry = _entries[_slots[slot]];
+		if (entry.id == id) {
+			return &entry;
+		}
+		slot = (slot + 1) & _slot_mask;
+	}
+	return nullptr;
+}
+
+device_info_t *Device_registry_base::add(const rom_address_t &address) {
+	uint64_t id = address_id(address);
+	device_info_t *entry = find(id);
+	if (entry != nullptr) {
+		return entry;
+	}
+	if (_size == _capacity) {
+		return nullptr;
+	}
+	entry = &_entries[_size];
+	*entry = device_info_t{};
+	entry->address = address;
+	entry->id = id;
+	index_entry(_size);
+	_size++;
+	return entry;
+}
+
+bool Device_registry_base::remove(uint64_t id) {
+	device_info_t *entry = find(id);
+	if (entry == nullptr) {
+		return false;
+	}
+	_size--;
+	*entry = _entries[_size];
+	// removal is rare (hot unplug), rebuilding the index keeps probing simple
+	for (size_t slot = 0; slot <= _slot_mask; slot++) {
+		_slots[slot] = -1;
+	}
+	for (size_t index = 0; index < _size; index++) {
+		index_entry(index);
+	}
+	return true;
+}
+
+void Device_registry_base::clear() {
+	for (size_t slot = 0; slot <= _slot_mask; slot++) {
+		_slots[slot] = -1;
+	}
+	_size = 0;
+}
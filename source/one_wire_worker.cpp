@@ -0,0 +1,70 @@
+#include "../api/one_wire_worker.h"
+
+#ifdef MOCK_PICO_PI
+
+#include "../test/pico_pi_mocks.h"
+
+#else
+
+#include "pico/multicore.h"
+
+#endif
+
+// core 1 runs one function with no argument, this is the worker it runs
+static std::atomic<One_wire_worker_base *> core1_worker{nullptr};
+
+bool One_wire_worker_base::start() {
+	One_wire_worker_base *idle = nullptr;
+	if (!core1_worker.compare_exchange_strong(idle, this)) {
+		return false;
+	}
+	_stop_requested.store(false, std::memory_order_relaxed);
+	_stopped.store(false, std::memory_order_release);
+	// core 1 is left in its exit state once an earlier worker returns, the launch
+	// handshake only works from reset
+	multicore_reset_core1();
+	multicore_launch_core1(core1_entry);
+	return true;
+}
+
+void One_wire_worker_base::stop() {
+	_stop_requested.store(true, std::memory_order_release);
+}
+
+void One_wire_worker_base::request_rescan() {
+	_rescan_requested.store(true, std::memory_order_release);
+}
+
+void One_wire_worker_base::core1_entry() {
+	One_wire_worker_base *worker = core1_worker.load(std::memory_order_acquire);
+	worker->run();
+	core1_worker.store(nullptr, std::memory_order_release);
+}
+
+void One_wire_worker_base::run() {
+	while (!_stop_requested.load(std::memory_order_acquire)) {
+		step();
+	}
+	_stopped.store(true, std::memory_order_release);
+}
+
+void One_wire_worker_base::step() {
+	if (_rescan_requested.exchange(false, std::memory_order_acq_rel)) {
+		_bus.find_and_count_devices_on_bus();
+	}
+	uint64_t now = time_us_64();
+	if (now < _next_cycle) {
+		sleep_us(_next_cycle - now);
+	} else {
+		_next_cycle = now;// running late, start the period again from here
+	}
+	_next_cycle += _period_us;
+
+	int count = _bus.read_all(_readings);
+	for (int i = 0; i < count; i++) {
+		reading_t reading{_readings.ids[i], _readings.timestamps[i], _readings.raw[i], _readings.crc_ok[i]};
+		if (!_queue.push(reading)) {
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
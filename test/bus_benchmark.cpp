@@ -0,0 +1,172 @@
+/*
+ * Runs the bus API against the simulated bus and reports the simulated bus
+ * time and master line transitions each call takes, as CSV on stdout.
+ *
+ * Given a previous run's output as its argument, exits with a failure if any
+ * row now takes longer or more transitions, so a change that adds slots or
+ * waits is caught on the desktop. Polled conversions must always beat the
+ * fixed wait, the simulated devices convert in their typical time.
+ */
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "one_wire.h"
+#include "one_wire_sim.h"
+
+static const uint bench_pin = 2;
+static const size_t device_counts[] = {1, 2, 4, 8, 16, 32, 64, 128};
+
+struct result_t {
+	std::string operation;
+	std::string engine;
+	size_t devices;
+	uint64_t bus_us;
+	uint64_t transitions;
+	uint64_t resets;
+	uint64_t slots;
+};
+
+class Bench_bus {
+public:
+	Bench_bus(size_t devices, bool pio) : _bus(_registry, bench_pin) {
+		uint64_t seed = devices;
+		_devices.reserve(devices);
+		for (size_t i = 0; i < devices; i++) {
+			seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+			_devices.emplace_back(FAMILY_CODE_DS18B20, seed >> 16);
+			_devices.back().set_temperature(20000 + (int32_t) i * 125);
+		}
+		for (Sim_thermometer &device : _devices) {
+			_sim.add(device);
+		}
+		_sim.attach(bench_pin);
+		_bus.init();
+		if (pio) {
+			_bus.use_pio(pio0);
+		}
+	}
+
+	~Bench_bus() { _sim.detach(); }
+
+	One_wire_base &bus() { return _bus; }
+
+	template<typename F>
+	result_t measure(const char *operation, const char *engine, F call) {
+		uint64_t started = mockTimeUs;
+		uint64_t transitions = _sim.transitions;
+		uint64_t resets = _sim.resets;
+		uint64_t slots = _sim.slots;
+		call(_bus);
+		return {operation, engine, _devices.size(), mockTimeUs - started, _sim.transitions - transitions,
+				_sim.resets - resets, _sim.slots - slots};
+	}
+
+private:
+	std::vector<Sim_thermometer> _devices;
+	One_wire_sim _sim;
+	Device_registry<128> _registry;
+	One_wire_base _bus;
+};
+
+static void run_engine(bool pio, std::vector<result_t> &results) {
+	const char *engine = pio ? "pio" : "gpio";
+	for (size_t devices : device_counts) {
+		Bench_bus bench(devices, pio);
+		results.push_back(bench.measure("find_and_count_devices_on_bus", engine, [](One_wire_base &bus) {
+			bus.find_and_count_devices_on_bus();
+		}));
+		results.push_back(bench.measure("convert_temperature", engine, [](One_wire_base &bus) {
+			rom_address_t address{};
+			bus.convert_temperature(address, true, true);
+		}));
+		results.push_back(bench.measure("convert_temperature_polled", engine, [](One_wire_base &bus) {
+			rom_address_t address{};
+			bus.set_conversion_polling(true);
+			bus.convert_temperature(address, true, true);
+			bus.set_conversion_polling(false);
+		}));
+		results.push_back(bench.measure("temperature", engine, [](One_wire_base &bus) {
+			bus.temperature(bus.get_address(0));
+		}));
+		results.push_back(bench.measure("read_all", engine, [](One_wire_base &bus) {
+			Bus_readings<128> readings;
+			bus.read_all(readings);
+		}));
+		Bus_readings<128> primed;
+		bench.bus().set_fast_read(true);
+		bench.bus().read_all(primed);// fast reads check against the last reading
+		results.push_back(bench.measure("read_all_fast", engine, [](One_wire_base &bus) {
+			Bus_readings<128> readings;
+			bus.read_all(readings);
+		}));
+	}
+}
+
+static int check_polling_gain(const std::vector<result_t> &results) {
+	// polling for the end of a conversion must beat waiting out the datasheet maximum
+	int regressions = 0;
+	for (const result_t &polled : results) {
+		if (polled.operation != "convert_temperature_polled") {
+			continue;
+		}
+		for (const result_t &fixed : results) {
+			if (fixed.operation == "convert_temperature" && fixed.engine == polled.engine &&
+				fixed.devices == polled.devices && polled.bus_us >= fixed.bus_us) {
+				fprintf(stderr, "polled convert %s %zu devices: %" PRIu64 " us, not faster than %" PRIu64 " us\n",
+						polled.engine.c_str(), polled.devices, polled.bus_us, fixed.bus_us);
+				regressions++;
+			}
+		}
+	}
+	return regressions;
+}
+
+static int compare_with_baseline(const char *path, const std::vector<result_t> &results) {
+	FILE *file = fopen(path, "r");
+	if (file == nullptr) {
+		fprintf(stderr, "can't open baseline %s\n", path);
+		return 1;
+	}
+	int regressions = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), file) != nullptr) {
+		char operation[64], engine[16];
+		size_t devices;
+		uint64_t bus_us, transitions;
+		if (sscanf(line, "%63[^,],%15[^,],%zu,%" SCNu64 ",%" SCNu64, operation, engine, &devices, &bus_us, &transitions) != 5) {
+			continue;// header
+		}
+		for (const result_t &result : results) {
+			if (result.operation == operation && result.engine == engine && result.devices == devices &&
+				(result.bus_us > bus_us || result.transitions > transitions)) {
+				fprintf(stderr, "regression %s %s %zu devices: %" PRIu64 " us (was %" PRIu64 "), %" PRIu64 " transitions (was %" PRIu64 ")\n",
+						operation, engine, devices, result.bus_us, bus_us, result.transitions, transitions);
+				regressions++;
+			}
+		}
+	}
+	fclose(file);
+	return regressions;
+}
+
+int main(int argc, char **argv) {
+	std::vector<result_t> results;
+	run_engine(false, results);
+	run_engine(true, results);
+
+	printf("operation,engine,devices,bus_us,transitions,resets,slots\n");
+	for (const result_t &result : results) {
+		printf("%s,%s,%zu,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", result.operation.c_str(), result.engine.c_str(),
+			   result.devices, result.bus_us, result.transitions, result.resets, result.slots);
+	}
+	if (check_polling_gain(results) != 0) {
+		return EXIT_FAILURE;
+	}
+	if (argc > 1 && compare_with_baseline(argv[1], results) != 0) {
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+/*
+ * Compares the CRC implementations against the original bitwise CRC8 and
+ * reports the time each takes per byte on this host.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "one_wire_crc.h"
+
+#define BENCH_BYTES (64 * 1024)
+#define BENCH_PASSES 64
+
+template<typename T>
+static double ns_per_byte(T (*crc_byte)(T, uint8_t), const std::vector<uint8_t> &data, T &result) {
+	auto start = std::chrono::steady_clock::now();
+	T crc = 0;
+	for (int pass = 0; pass < BENCH_PASSES; pass++) {
+		for (uint8_t byte : data) {
+			crc = crc_byte(crc, byte);
+		}
+	}
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	result = crc;
+	return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (BENCH_BYTES * BENCH_PASSES);
+}
+
+static int check_crc8() {
+	int errors = 0;
+	for (int crc = 0; crc < 256; crc++) {
+		for (int byte = 0; byte < 256; byte++) {
+			uint8_t expected = One_wire_crc::crc8_bitwise((uint8_t) crc, (uint8_t) byte);
+			if (One_wire_crc::crc8_nibble((uint8_t) crc, (uint8_t) byte) != expected ||
+				One_wire_crc::crc8_table((uint8_t) crc, (uint8_t) byte) != expected) {
+				errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+static int check_crc16() {
+	int errors = 0;
+	for (int crc = 0; crc < 65536; crc++) {
+		for (int byte = 0; byte < 256; byte++) {
+			uint16_t expected = One_wire_crc::crc16_bitwise((uint16_t) crc, (uint8_t) byte);
+			if (One_wire_crc::crc16_nibble((uint16_t) crc, (uint8_t) byte) != expected ||
+				One_wire_crc::crc16_table((uint16_t) crc, (uint8_t) byte) != expected) {
+				errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+int main() {
+	int errors = check_crc8() + check_crc16();
+	printf("crc check mismatches: %d\n", errors);
+
+	std::vector<uint8_t> data(BENCH_BYTES);
+	srand(1);
+	for (uint8_t &byte : data) {
+		byte = (uint8_t) rand();
+	}
+
+	uint8_t crc8_results[3];
+	uint16_t crc16_results[3];
+	printf("crc8  bitwise %6.2f ns/byte\n", ns_per_byte(One_wire_crc::crc8_bitwise, data, crc8_results[0]));
+	printf("crc8  nibble  %6.2f ns/byte\n", ns_per_byte(One_wire_crc::crc8_nibble, data, crc8_results[1]));
+	printf("crc8  table   %6.2f ns/byte\n", ns_per_byte(One_wire_crc::crc8_table, data, crc8_results[2]));
+	printf("crc16 bitwise %6.2f ns/byte\n", ns_per_byte(One_wire_crc::crc16_bitwise, data, crc16_results[0]));
+	printf("crc16 nibble  %6.2f ns/byte\n", ns_per_byte(One_wire_crc::crc16_nibble, data, crc16_results[1]));
+	printf("crc16 table   %6.2f ns/byte\n", ns_per_byte(One_wire_crc::crc16_table, data, crc16_results[2]));
+
+	if (crc8_results[1] != crc8_results[0] || crc8_results[2] != crc8_results[0] ||
+		crc16_results[1] != crc16_results[0] || crc16_results[2] != crc16_results[0]) {
+		errors++;
+	}
+	return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
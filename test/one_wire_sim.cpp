@@ -0,0 +1,497 @@
+#include "one_wire_sim.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "one_wire_crc.h"
+#include "pico_pi_mocks.h"
+
+// Slot timings as a device sees them, in microseconds
+static const uint64_t reset_min_low = 480;
+static const uint64_t write_1_max_low = 15;
+static const uint64_t write_0_max_low = 120;
+static const uint64_t presence_start = 30;// after the master releases the reset
+static const uint64_t presence_length = 120;
+static const uint64_t zero_hold = 30;// a device sending 0 holds the line from the start of the slot
+
+static const uint8_t SearchROM = 0xF0;
+static const uint8_t AlarmSearch = 0xEC;
+static const uint8_t ReadROM = 0x33;
+static const uint8_t MatchROM = 0x55;
+static const uint8_t SkipROM = 0xCC;
+
+Sim_device::Sim_device(uint8_t family, uint64_t serial)
+		: _rom(make_rom(family, serial)) {
+}
+
+rom_address_t Sim_device::make_rom(uint8_t family, uint64_t serial) {
+	rom_address_t rom{};
+	rom.rom[0] = family;
+	for (int i = 1; i < 7; i++) {
+		rom.rom[i] = (uint8_t) (serial >> (8 * (i - 1)));
+	}
+	rom.rom[7] = One_wire_crc::crc8(rom.rom, 7);
+	return rom;
+}
+
+uint64_t Sim_device::id() const {
+	uint64_t id = 0;
+	for (uint8_t byte : _rom.rom) {
+		id = (id << 8) | byte;
+	}
+	return id;
+}
+
+bool Sim_device::rom_bit(size_t index) const {
+	return (_rom.rom[index / 8] >> (index % 8)) & 1;
+}
+
+void Sim_device::reset(uint64_t now) {
+	_mode = mode_t::rom_command;
+	_shift = 0;
+	_bits = 0;
+}
+
+void Sim_device::transmit(const uint8_t *data, size_t bits) {
+	_tx.assign(data, data + (bits + 7) / 8);
+	_tx_bits = bits;
+	_bits = 0;
+	_mode = mode_t::transmit;
+}
+
+void Sim_device::receive() {
+	_shift = 0;
+	_bits = 0;
+	_mode = mode_t::receive;
+}
+
+void Sim_device::hold_busy() {
+	_mode = mode_t::busy;
+}
+
+bool Sim_device::slot_begin(uint64_t now) {
+	switch (_mode) {
+		case mode_t::transmit:
+			if (_bits < _tx_bits) {
+				return ((_tx[_bits / 8] >> (_bits % 8)) & 1) == 0;
+			}
+			return false;
+		case mode_t::search:
+			if (_search_phase == 0) {
+				return !rom_bit(_bits);
+			}
+			if (_search_phase == 1) {
+				return rom_bit(_bits);// the complement
+			}
+			return false;
+		case mode_t::busy:
+			return busy(now);
+		default:
+			return false;
+	}
+}
+
+void Sim_device::slot_end(bool bit, uint64_t now) {
+	switch (_mode) {
+		case mode_t::rom_command:
+		case mode_t::function_command:
+		case mode_t::receive:
+			_shift = (uint8_t) ((_shift >> 1) | (bit ? 0x80 : 0));
+			if (++_bits % 8 != 0) {
+				break;
+			}
+			if (_mode == mode_t::rom_command) {
+				rom_command(_shift, now);
+			} else if (_mode == mode_t::function_command) {
+				function_commands++;
+				_mode = mode_t::idle;// unless the command picks a mode
+				function_command(_shift, now);
+			} else {
+				byte_received(_bits / 8 - 1, _shift, now);
+			}
+			break;
+		case mode_t::match_rom:
+			_matched = _matched && bit == rom_bit(_bits);
+			if (++_bits == 64) {
+				_mode = _matched ? mode_t::function_command : mode_t::idle;
+				_bits = 0;
+			}
+			break;
+		case mode_t::search:
+			if (_search_phase < 2) {
+				_search_phase++;
+				break;
+			}
+			if (bit != rom_bit(_bits)) {
+				_mode = mode_t::idle;// the master went down the other branch
+				break;
+			}
+			_search_phase = 0;
+			if (++_bits == 64) {
+				_mode = mode_t::function_command;// the device found is selected
+				_bits = 0;
+			}
+			break;
+		case mode_t::transmit:
+			if (++_bits == _tx_bits) {
+				_mode = _after_transmit;
+				_after_transmit = mode_t::idle;
+				_bits = 0;
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+void Sim_device::rom_command(uint8_t command, uint64_t now) {
+	_bits = 0;
+	switch (command) {
+		case AlarmSearch:
+			if (!alarmed(now)) {
+				_mode = mode_t::idle;
+				break;
+			}
+			// fall through
+		case SearchROM:
+			_mode = mode_t::search;
+			_search_phase = 0;
+			break;
+		case ReadROM:
+			transmit(_rom.rom, 64);
+			_after_transmit = mode_t::function_command;
+			break;
+		case MatchROM:
+			_mode = mode_t::match_rom;
+			_matched = true;
+			break;
+		case SkipROM:
+			_mode = mode_t::function_command;
+			break;
+		default:
+			_mode = mode_t::idle;// overdrive and resume are not simulated
+			break;
+	}
+}
+
+Sim_thermometer::Sim_thermometer(uint8_t family, uint64_t serial, bool parasite)
+		: Sim_device(family, serial), _family(family), _parasite(parasite) {
+	// power on state
+	_eeprom[0] = 75;
+	_eeprom[1] = 70;
+	_eeprom[2] = 0x7F;
+	if (_family == 0x10) {
+		_scratch_pad[0] = 0xAA;// 85 degC
+		_scratch_pad[1] = 0x00;
+		_scratch_pad[4] = 0xFF;
+		_scratch_pad[5] = 0xFF;
+		_scratch_pad[6] = 0x0C;
+		_scratch_pad[7] = 0x10;
+	} else {
+		_scratch_pad[0] = 0x50;// 85 degC
+		_scratch_pad[1] = 0x05;
+		_scratch_pad[4] = has_config_register() ? _eeprom[2] : 0x00;
+		_scratch_pad[5] = 0xFF;
+		_scratch_pad[6] = 0x0C;
+		_scratch_pad[7] = 0x10;
+	}
+	if (_family == 0x3B) {
+		_scratch_pad[2] = 0xFF;// no alarm thresholds
+		_scratch_pad[3] = 0xFF;
+	} else {
+		_scratch_pad[2] = _eeprom[0];
+		_scratch_pad[3] = _eeprom[1];
+	}
+	update_crc();
+}
+
+bool Sim_thermometer::has_config_register() const {
+	return _family == 0x28 || _family == 0x22;
+}
+
+uint64_t Sim_thermometer::conversion_time() const {
+	return max_conversion_time() * _conversion_percent / 100;
+}
+
+uint64_t Sim_thermometer::max_conversion_time() const {
+	if (_family == 0x3B) {
+		return 150000;
+	}
+	if (!has_config_register()) {
+		return 750000;
+	}
+	return 93750u << ((_scratch_pad[4] >> 5) & 0x03);
+}
+
+void Sim_thermometer::update_crc() {
+	_scratch_pad[8] = One_wire_crc::crc8(_scratch_pad, 8);
+}
+
+void Sim_thermometer::function_command(uint8_t command, uint64_t now) {
+	switch (command) {
+		case 0x44:// Convert T
+			conversions++;
+			_converting = true;
+			_conversion_done = now + conversion_time();
+			hold_busy();
+			break;
+		case 0xBE:// Read Scratch Pad
+			complete_conversion(now);
+			transmit(_scratch_pad, 72);
+			break;
+		case 0x4E:// Write Scratch Pad
+			receive();
+			break;
+		case 0x48:// Copy Scratch Pad
+			_eeprom[0] = _scratch_pad[2];
+			_eeprom[1] = _scratch_pad[3];
+			_eeprom[2] = _scratch_pad[4];
+			break;
+		case 0xB8:// Recall E2
+			_scratch_pad[2] = _eeprom[0];
+			_scratch_pad[3] = _eeprom[1];
+			if (has_config_register()) {
+				_scratch_pad[4] = _eeprom[2];
+			}
+			update_crc();
+			break;
+		case 0xB4: {// Read Power Supply
+			uint8_t powered = _parasite ? 0x00 : 0x01;
+			transmit(&powered, 1);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void Sim_thermometer::byte_received(size_t index, uint8_t data, uint64_t now) {
+	if (index < 2 && _family != 0x3B) {
+		_scratch_pad[2 + index] = data;// T(H), T(L)
+	} else if (index == 2 && has_config_register()) {
+		_scratch_pad[4] = (uint8_t) ((data & 0x60) | 0x1F);// only the resolution bits are writable
+	}
+	update_crc();
+}
+
+bool Sim_thermometer::busy(uint64_t now) {
+	complete_conversion(now);
+	return _converting;
+}
+
+bool Sim_thermometer::alarmed(uint64_t now) {
+	complete_conversion(now);
+	if (_family == 0x3B) {
+		return false;
+	}
+	// compare the integer part of the temperature register with T(H) and T(L)
+	int degrees;
+	if (_family == 0x10) {
+		degrees = (int16_t) ((_scratch_pad[1] << 8) | _scratch_pad[0]) >> 1;
+	} else {
+		degrees = (int16_t) ((_scratch_pad[1] << 8) | _scratch_pad[0]) >> 4;
+	}
+	return degrees >= (int8_t) _scratch_pad[2] || degrees <= (int8_t) _scratch_pad[3];
+}
+
+void Sim_thermometer::complete_conversion(uint64_t now) {
+	if (!_converting || now < _conversion_done) {
+		return;
+	}
+	_converting = false;
+	int16_t raw;
+	if (_family == 0x10) {
+		// half degrees, truncated, with COUNT_REMAIN giving the fraction
+		int whole = (int) std::floor(_milli_c / 1000.0);
+		raw = (int16_t) std::floor(_milli_c / 500.0);
+		int remain = 16 - (int) std::lround((_milli_c - whole * 1000 + 250) * 16 / 1000.0);
+		_scratch_pad[6] = (uint8_t) (remain < 0 ? 0 : remain > 16 ? 16 : remain);
+	} else {
+		raw = (int16_t) std::floor(_milli_c * 16 / 1000.0);
+		if (has_config_register()) {
+			int undefined_bits = 3 - ((_scratch_pad[4] >> 5) & 0x03);
+			raw = (int16_t) (raw & ~((1 << undefined_bits) - 1));
+		}
+	}
+	_scratch_pad[0] = (uint8_t) raw;
+	_scratch_pad[1] = (uint8_t) (raw >> 8);
+	update_crc();
+}
+
+Sim_ds2502::Sim_ds2502(uint64_t serial)
+		: Sim_device(0x09, serial) {
+	for (uint8_t &byte : memory) {
+		byte = 0xFF;// unprogrammed EPROM
+	}
+}
+
+void Sim_ds2502::function_command(uint8_t command, uint64_t now) {
+	if (command == 0xF0 || command == 0xC3) {// Read Memory, Read Data/Generate 8-bit CRC
+		_command = command;
+		receive();
+	}
+}
+
+void Sim_ds2502::byte_received(size_t index, uint8_t data, uint64_t now) {
+	if (index == 0) {
+		_address = data;
+		return;
+	}
+	if (index != 1) {
+		return;
+	}
+	_address = (uint16_t) (_address | (data << 8));
+	uint8_t header[3] = {_command, (uint8_t) _address, (uint8_t) (_address >> 8)};
+	std::vector<uint8_t> out;
+	out.push_back(One_wire_crc::crc8(header, 3));
+	size_t address = _address;
+	if (_command == 0xF0) {
+		// data to the end of memory, then 1s
+		for (; address < memory_size; address++) {
+			out.push_back(memory[address]);
+		}
+	} else {
+		// data to the end of each page followed by the CRC of that page
+		while (address < memory_size) {
+			size_t page_end = (address / page_size + 1) * page_size;
+			size_t start = address;
+			for (; address < page_end; address++) {
+				out.push_back(memory[address]);
+			}
+			out.push_back(One_wire_crc::crc8(&memory[start], page_end - start));
+		}
+	}
+	transmit(out.data(), out.size() * 8);
+}
+
+Sim_max31826::Sim_max31826(uint64_t serial, bool parasite)
+		: Sim_thermometer(0x3B, serial, parasite) {
+	for (uint8_t &byte : memory) {
+		byte = 0xFF;// erased EEPROM
+	}
+}
+
+void Sim_max31826::function_command(uint8_t command, uint64_t now) {
+	switch (command) {
+		case 0x0F:// Write Scratch Pad 2, address then a block
+		case 0x55:// Copy Scratch Pad 2, validation byte
+		case 0xF0:// Read Memory, address
+			_command = command;
+			receive();
+			break;
+		case 0xAA:// Read Scratch Pad 2
+			_command = command;
+			transmit(_scratch_pad, sizeof(_scratch_pad) * 8);
+			break;
+		default:
+			_command = 0;
+			Sim_thermometer::function_command(command, now);
+			break;
+	}
+}
+
+void Sim_max31826::byte_received(size_t index, uint8_t data, uint64_t now) {
+	switch (_command) {
+		case 0x0F:
+			if (index == 0) {
+				_scratch_pad_address = (uint8_t) (data & (memory_size - block_size));
+			} else if (index <= block_size) {
+				_scratch_pad[index - 1] = data;
+				_scratch_pad[block_size] = One_wire_crc::crc8(_scratch_pad, block_size);
+			}
+			break;
+		case 0x55:
+			if (index == 0 && data == 0xA5) {
+				for (size_t i = 0; i < block_size; i++) {
+					memory[_scratch_pad_address + i] = _scratch_pad[i];
+				}
+				copies++;
+			}
+			break;
+		case 0xF0:
+			if (index == 0) {
+				// data to the end of memory, then 1s
+				memory_reads++;
+				size_t address = data % memory_size;
+				transmit(&memory[address], (memory_size - address) * 8);
+			}
+			break;
+		default:
+			Sim_thermometer::byte_received(index, data, now);
+			break;
+	}
+}
+
+void One_wire_sim::attach(uint pin) {
+	mockSimBus = this;
+	mockSimPin = pin;
+}
+
+void One_wire_sim::detach() {
+	if (mockSimBus == this) {
+		mockSimBus = nullptr;
+	}
+}
+
+void One_wire_sim::line_low(uint64_t now) {
+	if (_low) {
+		return;
+	}
+	_low = true;
+	_low_since = now;
+	transitions++;
+	if (_recovering) {
+		shortest_reset_recovery = std::min(shortest_reset_recovery, now - _reset_released);
+		_recovering = false;
+	}
+	bool zero = false;
+	for (Sim_device *device : _devices) {
+		zero = device->slot_begin(now) || zero;// every device sees the falling edge
+	}
+	if (slots == _glitch_slot) {
+		zero = true;
+		_glitch_slot = UINT64_MAX;
+	}
+	_held_until = zero ? now + zero_hold : 0;
+}
+
+void One_wire_sim::line_release(uint64_t now) {
+	if (!_low) {
+		return;
+	}
+	_low = false;
+	transitions++;
+	uint64_t low_time = now - _low_since;
+	if (low_time > write_0_max_low) {
+		shortest_reset_low = std::min(shortest_reset_low, low_time);
+		_recovering = true;
+		_reset_released = now;
+	}
+	if (low_time >= reset_min_low) {
+		resets++;
+		_held_until = 0;
+		if (!_devices.empty()) {
+			_presence_from = now + presence_start;
+			_presence_until = _presence_from + presence_length;
+		}
+		for (Sim_device *device : _devices) {
+			device->reset(now);
+		}
+		return;
+	}
+	slots++;
+	bool bit = low_time < write_1_max_low;
+	for (Sim_device *device : _devices) {
+		device->slot_end(bit, now);
+	}
+}
+
+bool One_wire_sim::line_high(uint64_t now) const {
+	if (_low) {
+		return false;
+	}
+	if (now < _held_until) {
+		return false;
+	}
+	return now < _presence_from || now >= _presence_until;
+}
@@ -0,0 +1,272 @@
+#ifndef ONE_WIRE_SIM_H
+#define ONE_WIRE_SIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "one_wire_registry.h"
+#include "pico_pi_mocks.h"
+
+/**
+ * A virtual 1-Wire slave, answering the ROM layer (search, alarm search, read,
+ * match and skip ROM) one time slot at a time. Families add their function
+ * commands on top.
+ */
+class Sim_device {
+public:
+	virtual ~Sim_device() = default;
+
+	[[nodiscard]] const rom_address_t &rom() const { return _rom; }
+
+	/**
+	 * @returns the ID as One_wire::to_uint64 gives it
+	 */
+	[[nodiscard]] uint64_t id() const;
+
+	/**
+	 * Build a ROM code with a valid CRC
+	 */
+	static rom_address_t make_rom(uint8_t family, uint64_t serial);
+
+	// Bus side, called by One_wire_sim
+
+	void reset(uint64_t now);
+
+	/**
+	 * The master pulled the line low to start a slot
+	 *
+	 * @returns true if this device holds the line low for the slot (sends a 0)
+	 */
+	bool slot_begin(uint64_t now);
+
+	/**
+	 * The master released the line, bit is what the slot wrote (1 for read slots)
+	 */
+	void slot_end(bool bit, uint64_t now);
+
+	uint32_t function_commands{};// function commands received, for checking what a test selected
+
+protected:
+	Sim_device(uint8_t family, uint64_t serial);
+
+	virtual void function_command(uint8_t command, uint64_t now) = 0;
+
+	/**
+	 * A byte arrived while receiving, index counts from 0 after the command
+	 */
+	virtual void byte_received(size_t index, uint8_t data, uint64_t now) {}
+
+	/**
+	 * While busy, read slots are held low
+	 */
+	virtual bool busy(uint64_t now) { return false; }
+
+	virtual bool alarmed(uint64_t now) { return false; }
+
+	/**
+	 * Send bits, least significant first, then 1s until the next reset
+	 */
+	void transmit(const uint8_t *data, size_t bits);
+
+	/**
+	 * Take bytes until the next reset, each reported to byte_received
+	 */
+	void receive();
+
+	/**
+	 * Answer read slots with busy() until the next reset
+	 */
+	void hold_busy();
+
+private:
+	enum class mode_t {
+		idle,
+		rom_command,
+		match_rom,
+		search,
+		function_command,
+		receive,
+		transmit,
+		busy
+	};
+
+	rom_address_t _rom{};
+	mode_t _mode{mode_t::idle};
+	mode_t _after_transmit{mode_t::idle};
+	uint8_t _shift{};
+	size_t _bits{};// bits received or sent in the current mode
+	bool _matched{};
+	int _search_phase{};// 0 bit, 1 complement, 2 direction from the master
+	std::vector<uint8_t> _tx;
+	size_t _tx_bits{};
+
+	[[nodiscard]] bool rom_bit(size_t index) const;
+
+	void rom_command(uint8_t command, uint64_t now);
+};
+
+/**
+ * Thermometer with its scratch pad, conversions take the time the family and
+ * resolution needs in simulated time. Covers the DS18B20, DS18S20, DS1822 and
+ * MAX31826 families.
+ */
+class Sim_thermometer : public Sim_device {
+public:
+	Sim_thermometer(uint8_t family, uint64_t serial, bool parasite = false);
+
+	/**
+	 * @param milli_c the temperature the next conversion measures, in 1/1000 degC
+	 */
+	void set_temperature(int32_t milli_c) { _milli_c = milli_c; }
+
+	[[nodiscard]] const uint8_t *scratch_pad() const { return _scratch_pad; }
+
+	/**
+	 * @param percent how long conversions take, as a percentage of the
+	 *        datasheet maximum: typical_conversion_percent by default, 100 for the worst case
+	 */
+	void set_conversion_percent(uint32_t percent) { _conversion_percent = percent; }
+
+	/**
+	 * @returns the conversion time in microseconds at the current resolution
+	 */
+	[[nodiscard]] uint64_t conversion_time() const;
+
+	/**
+	 * @returns the datasheet maximum conversion time at the current resolution
+	 */
+	[[nodiscard]] uint64_t max_conversion_time() const;
+
+	static const uint32_t typical_conversion_percent = 80;
+
+	uint32_t conversions{};
+
+protected:
+	void function_command(uint8_t command, uint64_t now) override;
+
+	void byte_received(size_t index, uint8_t data, uint64_t now) override;
+
+	bool busy(uint64_t now) override;
+
+	bool alarmed(uint64_t now) override;
+
+private:
+	uint8_t _family;
+	bool _parasite;
+	int32_t _milli_c{25000};
+	uint32_t _conversion_percent{typical_conversion_percent};
+	uint8_t _scratch_pad[9]{};
+	uint8_t _eeprom[3]{};// T(H), T(L), configuration
+	bool _converting{};
+	uint64_t _conversion_done{};
+
+	[[nodiscard]] bool has_config_register() const;
+
+	void complete_conversion(uint64_t now);
+
+	void update_crc();
+};
+
+/**
+ * DS2502 1k add-only memory, Read Memory and Read Data/Generate 8-bit CRC
+ */
+class Sim_ds2502 : public Sim_device {
+public:
+	static const size_t memory_size = 128;
+	static const size_t page_size = 32;
+
+	explicit Sim_ds2502(uint64_t serial);
+
+	uint8_t memory[memory_size]{};
+
+protected:
+	void function_command(uint8_t command, uint64_t now) override;
+
+	void byte_received(size_t index, uint8_t data, uint64_t now) override;
+
+private:
+	uint8_t _command{};
+	uint16_t _address{};
+};
+
+/**
+ * MAX31826 thermometer with its 1k bit EEPROM, written through scratch pad 2
+ */
+class Sim_max31826 : public Sim_thermometer {
+public:
+	static const size_t memory_size = 128;
+	static const size_t block_size = 8;
+
+	explicit Sim_max31826(uint64_t serial, bool parasite = false);
+
+	uint8_t memory[memory_size]{};
+	uint32_t copies{};// blocks copied from scratch pad 2 to the EEPROM
+	uint32_t memory_reads{};
+
+protected:
+	void function_command(uint8_t command, uint64_t now) override;
+
+	void byte_received(size_t index, uint8_t data, uint64_t now) override;
+
+private:
+	uint8_t _command{};
+	uint8_t _scratch_pad_address{};
+	uint8_t _scratch_pad[block_size + 1]{};// with its CRC
+};
+
+/**
+ * Slot level model of a bus, the mocks report when the master drives the line
+ * low or lets it go, and sample the line through it. The line is the wired-AND
+ * of the master and every device.
+ */
+class One_wire_sim {
+public:
+	/**
+	 * Route the mock gpio and PIO functions for pin through this bus
+	 */
+	void attach(uint pin);
+
+	void detach();
+
+	void add(Sim_device &device) { _devices.push_back(&device); }
+
+	void clear() { _devices.clear(); }
+
+	[[nodiscard]] size_t size() const { return _devices.size(); }
+
+	// Master side, called by the mocks
+
+	void line_low(uint64_t now);
+
+	void line_release(uint64_t now);
+
+	[[nodiscard]] bool line_high(uint64_t now) const;
+
+	/**
+	 * Hold the line low through a later slot as noise would, turning a 1 into
+	 * a 0. Slots count up from the slots counter below.
+	 */
+	void glitch(uint64_t slot) { _glitch_slot = slot; }
+
+	// Counters for benchmarks
+
+	uint64_t transitions{};// master edges
+	uint64_t resets{};
+	uint64_t slots{};
+	uint64_t shortest_reset_low{UINT64_MAX};     // of the lows too long to be a slot
+	uint64_t shortest_reset_recovery{UINT64_MAX};// from the end of a reset to the next falling edge
+
+private:
+	std::vector<Sim_device *> _devices;
+	bool _low{};
+	uint64_t _low_since{};
+	uint64_t _held_until{};  // a device is sending a 0 until then
+	uint64_t _presence_from{};
+	uint64_t _presence_until{};
+	uint64_t _glitch_slot{UINT64_MAX};
+	bool _recovering{};
+	uint64_t _reset_released{};
+};
+
+#endif// ONE_WIRE_SIM_H
@@ -1,29 +1,133 @@
+#ifdef MOCK_WITHOUT_CATCH
+#include <cassert>
+#define REQUIRE(expr) assert(expr)// benchmarks run the mocks outside a test case
+#else
 #include <catch2/catch_test_macros.hpp>
+#endif
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 #include <vector>
 
 #include "pico_pi_mocks.h"
+#include "one_wire_sim.h"
 
 #define STRING_STACK_LIMIT 100
 
 std::vector<uint8_t> mockLastCommands;
 uint8_t mockLastCommand;//Stores the last 8 bits written to the bus
-int mockReadBitPos;
+size_t mockReadBitPos;
 size_t mockReadBitsLength;
 const char *mockReadBits;
 int waitTime;
 int writeCount;
+uint64_t mockTimeUs;
 bool gpio_out_direction[30];
 bool gpio_initialised[30]{false};
 
+pio_hw_t mockPio0{0};
+pio_hw_t mockPio1{1};
+static const uint16_t mockPioInstructions[23]{};
+const pio_program_t onewire_program{mockPioInstructions, 23, -1};
+std::deque<uint32_t> mockPioRxFifo;
+bool mockPioAvailable = true;
+bool mockPioStrongPullup;
+int mockPioWordsWritten;
+uint mockPioOffset;
+bool mockPioEnabled;
+float mockPioClkdiv;
+bool mockOverdrive;// devices switched to overdrive by an Overdrive Skip/Match ROM
+int mockBitsSinceReset;
+bool mockLineHigh[30];
+bool mockResetIgnored;// overdrive reset with every device at standard speed, nobody answers
+std::vector<uint8_t> mockPinCommands[30];
+uint8_t mockPinByte[30];
+int mockPinBits[30];
+uint64_t mockPinLowAt[30];
+uint32_t mockMaskedPins;// pins driven through the masked functions
+void (*mockCore1Entry)();
+One_wire_sim *mockSimBus;
+uint mockSimPin;
+
+struct mock_alarm_t {
+	alarm_id_t id;
+	uint64_t due;
+	alarm_callback_t callback;
+	void *user_data;
+};
+std::vector<mock_alarm_t> mockAlarms;
+uint64_t mockLongestAlarmCallbackUs;
+uint64_t mockLongestMaskedUs;
+static bool mockInAlarmCallback;
+static uint64_t mockMaskedSinceUs;
+alarm_id_t mockNextAlarmId = 1;
+
+static void mockTrackCommand() {
+	// the first byte after a reset is the ROM command
+	mockBitsSinceReset++;
+	if (mockBitsSinceReset == 8 && (mockLastCommand == 0x3C || mockLastCommand == 0x69)) {
+		mockOverdrive = true;
+	}
+}
+
+static void mockWriteBit(bool bit) {
+	if ((writeCount > 0) && (writeCount % 8 == 0)) {
+		mockLastCommands.push_back(mockLastCommand);
+		mockLastCommand = 0;
+	}
+	mockLastCommand >>= 1;
+	if (bit) {
+		mockLastCommand |= (1 << 7);
+	}
+	writeCount++;
+	mockTrackCommand();
+}
+
+static bool mockReadBit() {
+	bool ret = true;
+	if (mockReadBitPos < mockReadBitsLength) {
+		if (mockReadBits[mockReadBitPos] == '0') {
+			ret = false;
+		}
+		mockReadBitPos++;
+	} else {
+		printf("Ran out of mock data\n");
+	}
+	return ret;
+}
+
+static bool mockSimulated(uint gpio) {
+	return mockSimBus != nullptr && gpio == mockSimPin;
+}
+
+static void mockSimDrive(uint gpio) {
+	// the master pulls the line low only while it is an output set low
+	if (!mockSimulated(gpio)) {
+		return;
+	}
+	if (gpio_out_direction[gpio] && !mockLineHigh[gpio]) {
+		mockSimBus->line_low(mockTimeUs);
+	} else {
+		mockSimBus->line_release(mockTimeUs);
+	}
+}
+
 void gpio_init(uint gpio) {
 	gpio_initialised[gpio] = true;
 }
 
-void gpio_put(uint gpio, bool value) {
+bool mockOutputHigh(uint gpio) {
 	REQUIRE(gpio_initialised[gpio] == true);
 	REQUIRE(gpio_out_direction[gpio] == true);
+	return mockLineHigh[gpio];
+}
+
+void gpio_put(uint gpio, bool value) {
+	REQUIRE(gpio_initialised[gpio] == true);
+	mockLineHigh[gpio] = value;
+	if (!gpio_out_direction[gpio]) {
+		return;// latched for when the pin is made an output
+	}
 	if (value == 0) {
 		waitTime = 0;
 	} else {
@@ -31,13 +135,28 @@ void gpio_put(uint gpio, bool value) {
 			mockLastCommands.push_back(mockLastCommand);
 			mockLastCommand = 0;
 		}
-		if (waitTime > 1 && waitTime <= 15) {//Spec for write bit 1
-			mockLastCommand >>= 1;
-			mockLastCommand |= (1 << 7);
-		}
-		if (waitTime >= 10 && waitTime <= 120) {//Spec for write bit 0
-			mockLastCommand >>= 1;
-			mockLastCommand &= ~(1 << 7);
+		if (mockOverdrive) {
+			if (waitTime >= 1 && waitTime <= 2) {//Spec for overdrive write bit 1
+				mockLastCommand >>= 1;
+				mockLastCommand |= (1 << 7);
+				mockTrackCommand();
+			}
+			if (waitTime >= 6 && waitTime <= 16) {//Spec for overdrive write bit 0
+				mockLastCommand >>= 1;
+				mockLastCommand &= ~(1 << 7);
+				mockTrackCommand();
+			}
+		} else {
+			if (waitTime > 1 && waitTime <= 15) {//Spec for write bit 1
+				mockLastCommand >>= 1;
+				mockLastCommand |= (1 << 7);
+				mockTrackCommand();
+			}
+			if (waitTime >= 10 && waitTime <= 120) {//Spec for write bit 0
+				mockLastCommand >>= 1;
+				mockLastCommand &= ~(1 << 7);
+				mockTrackCommand();
+			}
 		}
 		if (waitTime > 480) {//Spec for reset
 			mockLastCommands.push_back(mockLastCommand);
@@ -46,32 +165,433 @@ void gpio_put(uint gpio, bool value) {
 		}
 		writeCount++;
 	}
+	mockSimDrive(gpio);
 }
 
 bool gpio_get(uint gpio) {
-	int ret = 1;
 	REQUIRE(gpio_initialised[gpio] == true);
 	REQUIRE(gpio_out_direction[gpio] == false);
-	if (mockReadBitPos < mockReadBitsLength) {
-		if (mockReadBits[mockReadBitPos] == '0') {
-			ret = 0;
-		}
-		mockReadBitPos++;
-	} else {
-		printf("Ran out of mock data\n");
+	if (mockSimulated(gpio)) {
+		return mockSimBus->line_high(mockTimeUs);
 	}
-	return ret;
+	if (mockResetIgnored) {
+		mockResetIgnored = false;
+		return true;
+	}
+	return mockReadBit();
 }
 
 void gpio_set_dir(uint gpio, bool out) {
 	REQUIRE(gpio_initialised[gpio] == true);
+	if (!out && gpio_out_direction[gpio] && !mockLineHigh[gpio]) {
+		// releasing the bus, a long enough low was a reset
+		if (waitTime >= 480) {
+			mockOverdrive = false;// a standard speed reset returns every device to standard speed
+			mockBitsSinceReset = 0;
+		} else if (waitTime >= 48 && waitTime <= 80) {
+			mockBitsSinceReset = 0;
+			mockResetIgnored = !mockOverdrive;
+		}
+	}
 	gpio_out_direction[gpio] = out;
+	mockSimDrive(gpio);
+}
+
+static uint32_t mockSioPins;// pins driven through the SIO registers
+
+static void mockSioPut(uint32_t mask, bool value) {
+	mockSioPins |= mask;
+	for (uint pin = 0; pin < 30; pin++) {
+		if ((mask & (1u << pin)) == 0) {
+			continue;
+		}
+		if (gpio_out_direction[pin]) {
+			gpio_put(pin, value);
+		} else {
+			REQUIRE(gpio_initialised[pin] == true);
+			mockLineHigh[pin] = value;// latched until the pin is made an output
+		}
+	}
+}
+
+static void mockSioDirection(uint32_t mask, bool out) {
+	mockSioPins |= mask;
+	for (uint pin = 0; pin < 30; pin++) {
+		if ((mask & (1u << pin)) == 0) {
+			continue;
+		}
+		if (out && !gpio_out_direction[pin] && !mockLineHigh[pin]) {
+			waitTime = 0;// the latched low reaches the line now
+		}
+		gpio_set_dir(pin, out);
+	}
+}
+
+static uint32_t mockSioIn() {
+	// only the SIO driven inputs are sampled, each takes a mock bit unless simulated
+	uint32_t pins = 0;
+	for (uint pin = 0; pin < 30; pin++) {
+		if ((mockSioPins & (1u << pin)) != 0 && !gpio_out_direction[pin] && gpio_get(pin)) {
+			pins |= 1u << pin;
+		}
+	}
+	return pins;
+}
+
+sio_hw_t mockSio = {
+		{nullptr, mockSioIn},
+		{[](uint32_t mask) { mockSioPut(mask, true); }, nullptr},
+		{[](uint32_t mask) { mockSioPut(mask, false); }, nullptr},
+		{[](uint32_t mask) { mockSioDirection(mask, true); }, nullptr},
+		{[](uint32_t mask) { mockSioDirection(mask, false); }, nullptr},
+};
+
+void mockClearPinCommands() {
+	for (uint pin = 0; pin < 30; pin++) {
+		mockPinCommands[pin].clear();
+		mockPinByte[pin] = 0;
+		mockPinBits[pin] = 0;
+	}
+}
+
+static void mockPinWriteBit(uint pin, bool bit) {
+	mockPinByte[pin] >>= 1;
+	if (bit) {
+		mockPinByte[pin] |= (1 << 7);
+	}
+	if (++mockPinBits[pin] == 8) {
+		mockPinCommands[pin].push_back(mockPinByte[pin]);
+		mockPinByte[pin] = 0;
+		mockPinBits[pin] = 0;
+	}
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value) {
+	for (uint pin = 0; pin < 30; pin++) {
+		if ((mask & (1u << pin)) == 0) {
+			continue;
+		}
+		REQUIRE(gpio_initialised[pin] == true);
+		bool high = (value & (1u << pin)) != 0;
+		if (!high) {
+			mockPinLowAt[pin] = mockTimeUs;
+		} else if (gpio_out_direction[pin] && !mockLineHigh[pin]) {
+			// each pin decodes its own write slots from how long it was held low
+			uint64_t low = mockTimeUs - mockPinLowAt[pin];
+			if (low >= 1 && low <= 15) {
+				mockPinWriteBit(pin, true);
+			} else if (low > 15 && low <= 120) {
+				mockPinWriteBit(pin, false);
+			}
+		}
+		mockLineHigh[pin] = high;
+	}
+}
+
+void gpio_set_dir_masked(uint32_t mask, uint32_t value) {
+	for (uint pin = 0; pin < 30; pin++) {
+		if ((mask & (1u << pin)) == 0) {
+			continue;
+		}
+		REQUIRE(gpio_initialised[pin] == true);
+		mockMaskedPins |= 1u << pin;
+		bool out = (value & (1u << pin)) != 0;
+		if (!out && gpio_out_direction[pin] && !mockLineHigh[pin] && mockTimeUs - mockPinLowAt[pin] >= 480) {
+			mockPinByte[pin] = 0;// reset, start a new command
+			mockPinBits[pin] = 0;
+		}
+		gpio_out_direction[pin] = out;
+	}
+}
+
+uint32_t gpio_get_all() {
+	// every input pin of the masked buses takes the next mock bit, lowest pin first
+	uint32_t pins = 0;
+	for (uint pin = 0; pin < 30; pin++) {
+		if ((mockMaskedPins & (1u << pin)) == 0) {
+			continue;
+		}
+		bool high = gpio_out_direction[pin] ? mockLineHigh[pin] : mockReadBit();
+		if (high) {
+			pins |= 1u << pin;
+		}
+	}
+	return pins;
+}
+
+void multicore_reset_core1() {
+	mockCore1Entry = nullptr;
+}
+
+void multicore_launch_core1(void (*entry)()) {
+	REQUIRE(mockCore1Entry == nullptr);// a second launch without a reset hangs the handshake
+	mockCore1Entry = entry;
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+	mockAlarms.push_back({mockNextAlarmId, mockTimeUs + us, callback, user_data});
+	return mockNextAlarmId++;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id) {
+	for (auto alarm = mockAlarms.begin(); alarm != mockAlarms.end(); alarm++) {
+		if (alarm->id == alarm_id) {
+			mockAlarms.erase(alarm);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool mockFireAlarm() {
+	if (mockAlarms.empty()) {
+		return false;
+	}
+	auto earliest = mockAlarms.begin();
+	for (auto alarm = mockAlarms.begin(); alarm != mockAlarms.end(); alarm++) {
+		if (alarm->due < earliest->due) {
+			earliest = alarm;
+		}
+	}
+	mock_alarm_t alarm = *earliest;
+	mockAlarms.erase(earliest);
+	if (alarm.due > mockTimeUs) {
+		sleep_us((int) (alarm.due - mockTimeUs));
+	}
+	uint64_t called = mockTimeUs;
+	mockInAlarmCallback = true;
+	int64_t reschedule = alarm.callback(alarm.id, alarm.user_data);
+	mockInAlarmCallback = false;
+	mockLongestAlarmCallbackUs = std::max(mockLongestAlarmCallbackUs, mockTimeUs - called);
+	if (reschedule != 0) {
+		// as the pico-sdk: positive is relative to when the callback returns, negative to when the alarm was due
+		alarm.due = reschedule > 0 ? mockTimeUs + reschedule : alarm.due - reschedule;
+		mockAlarms.push_back(alarm);
+	}
+	return true;
+}
+
+size_t mockPendingAlarms() {
+	return mockAlarms.size();
+}
+
+static uint64_t mockInterruptPeriodUs;
+static uint64_t mockInterruptLengthUs;
+static uint64_t mockNextInterruptUs;
+static bool mockInterruptUnmaskable;
+static bool mockInterruptsDisabled;
+
+static uint32_t mockTimerReadInterruptEvery;
+static uint32_t mockTimerReads;
+static bool mockTimerReadInterruptPending;
+
+void mockInterrupts(uint64_t period_us, uint64_t length_us, bool unmaskable) {
+	mockInterruptPeriodUs = period_us;
+	mockInterruptLengthUs = length_us;
+	mockInterruptUnmaskable = unmaskable;
+	mockNextInterruptUs = mockTimeUs + period_us;
+}
+
+void mockTimerReadInterrupts(uint32_t every, uint64_t length_us) {
+	mockTimerReadInterruptEvery = every;
+	mockTimerReads = 0;
+	mockTimerReadInterruptPending = false;
+	mockInterruptLengthUs = length_us;
+}
+
+static void mockRunInterrupts() {
+	// the handler takes the time, while the pins stay as they were
+	while (mockInterruptPeriodUs != 0 && mockTimeUs >= mockNextInterruptUs &&
+		   (!mockInterruptsDisabled || mockInterruptUnmaskable)) {
+		waitTime += (int) mockInterruptLengthUs;
+		mockTimeUs += mockInterruptLengthUs;
+		mockNextInterruptUs = mockTimeUs + mockInterruptPeriodUs;
+	}
+	if (mockTimerReadInterruptPending && !mockInterruptsDisabled) {
+		mockTimerReadInterruptPending = false;
+		waitTime += (int) mockInterruptLengthUs;
+		mockTimeUs += mockInterruptLengthUs;
+	}
+}
+
+static void mockPassTime(uint64_t us) {
+	waitTime += (int) us;
+	mockTimeUs += us;
+	mockRunInterrupts();
 }
 
 void sleep_us(int us) {
-	waitTime += us;
+	REQUIRE(!mockInAlarmCallback);// the pico-sdk panics on a sleep from an interrupt
+	mockPassTime(us);
 }
 
 void sleep_ms(int ms) {
-	waitTime += ms * 1000;
+	REQUIRE(!mockInAlarmCallback);
+	mockPassTime((uint64_t) ms * 1000);
+}
+
+void busy_wait_us_32(uint32_t delay_us) {
+	mockPassTime(delay_us);
+}
+
+uint64_t time_us_64() {
+	return mockTimeUs;
+}
+
+uint32_t time_us_32() {
+	auto now = (uint32_t) mockTimeUs;
+	if (mockTimerReadInterruptEvery != 0 && ++mockTimerReads % mockTimerReadInterruptEvery == 0) {
+		mockTimerReadInterruptPending = true;// taken straight after the timer is read
+		mockRunInterrupts();
+	}
+	return now;
+}
+
+uint32_t save_and_disable_interrupts() {
+	uint32_t status = mockInterruptsDisabled ? 0 : 1;
+	if (!mockInterruptsDisabled) {
+		mockMaskedSinceUs = mockTimeUs;
+	}
+	mockInterruptsDisabled = true;
+	return status;
+}
+
+void restore_interrupts(uint32_t status) {
+	if (mockInterruptsDisabled && status != 0) {
+		mockLongestMaskedUs = std::max(mockLongestMaskedUs, mockTimeUs - mockMaskedSinceUs);
+	}
+	mockInterruptsDisabled = status == 0;
+	mockRunInterrupts();
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+	REQUIRE(clk_index == clk_sys);
+	return 125000000;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program) {
+	REQUIRE(program == &onewire_program);
+	return mockPioAvailable;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+	REQUIRE(mockPioAvailable);
+	return mockPioOffset;
+}
+
+void pio_remove_program(PIO pio, const pio_program_t *program, uint loaded_offset) {
+	REQUIRE(loaded_offset == mockPioOffset);
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+	return mockPioAvailable ? 0 : -1;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm) {
+	REQUIRE(sm == 0);
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+	mockPioEnabled = enabled;
+}
+
+void onewire_program_init(PIO pio, uint sm, uint offset, uint pin, float clkdiv) {
+	REQUIRE(offset == mockPioOffset);
+	REQUIRE(clkdiv == 125.0f);
+	mockPioRxFifo.clear();
+	mockPioStrongPullup = false;
+	mockPioWordsWritten = 0;
+	mockPioEnabled = true;
+	mockPioClkdiv = clkdiv;
+}
+
+uint pio_encode_jmp(uint addr) {
+	return addr;// unconditional jmp encodes as just the address
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+	REQUIRE(mockPioEnabled);
+	REQUIRE(instr == mockPioOffset + onewire_offset_reset);
+	mockBitsSinceReset = 0;
+	if (mockSimBus != nullptr) {
+		// the program's reset, slowed down 7 times at standard speed
+		int scale = mockPioClkdiv == 125.0f ? 7 : 1;
+		mockSimBus->line_low(mockTimeUs);
+		sleep_us(496 * scale / 7);
+		mockSimBus->line_release(mockTimeUs);
+		sleep_us(64 * scale / 7);
+		mockPioRxFifo.push_back(mockSimBus->line_high(mockTimeUs) ? 0x80000000u : 0);
+		sleep_us(416 * scale / 7);
+		return;
+	}
+	if (mockPioClkdiv == 125.0f) {
+		mockOverdrive = false;// a standard speed reset returns every device to standard speed
+	} else if (!mockOverdrive) {
+		mockPioRxFifo.push_back(0x80000000u);// overdrive reset, nobody answers
+		return;
+	}
+	// presence sample, pushed in the top bit
+	mockPioRxFifo.push_back(mockReadBit() ? 0x80000000u : 0);
+}
+
+static bool mockSimPioSlot(bool one) {
+	// the program's bit slot, a 1 (or read) releases after 7us and samples at 11us
+	int scale = mockPioClkdiv == 125.0f ? 7 : 1;
+	mockSimBus->line_low(mockTimeUs);
+	if (!one) {
+		sleep_us(62 * scale / 7);
+		mockSimBus->line_release(mockTimeUs);
+		sleep_us(7 * scale / 7);
+		return false;
+	}
+	sleep_us(7 * scale / 7);
+	mockSimBus->line_release(mockTimeUs);
+	sleep_us(4 * scale / 7);
+	bool bit = mockSimBus->line_high(mockTimeUs);
+	sleep_us(53 * scale / 7);
+	return bit;
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+	REQUIRE(mockPioEnabled);
+	REQUIRE(mockPioRxFifo.size() < 4);
+	uint count = (data & 0xFF) + 1;
+	bool read = (data & 0x80000000u) != 0;
+	uint32_t isr = 0;
+	for (uint i = 0; i < count; i++) {
+		bool bit = (data >> (8 + i)) & 1;
+		if (mockSimBus != nullptr) {
+			bool sampled = mockSimPioSlot(read || bit);
+			if (read) {
+				bit = sampled;
+			} else {
+				mockWriteBit(bit);
+			}
+		} else if (read) {
+			bit = mockReadBit();
+		} else {
+			mockWriteBit(bit);
+		}
+		isr = (isr >> 1) | (bit ? 0x80000000u : 0);
+	}
+	mockPioRxFifo.push_back(isr);
+	mockPioWordsWritten++;
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm) {
+	REQUIRE(!mockPioRxFifo.empty());
+	uint32_t data = mockPioRxFifo.front();
+	mockPioRxFifo.pop_front();
+	return data;
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask) {
+	mockPioStrongPullup = (pin_values & pin_mask) != 0;
+}
+
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask) {
+}
+
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div) {
+	mockPioClkdiv = div;
 }
@@ -1,7 +1,9 @@
 #ifndef PICO_PI_MOCKS_H
 #define PICO_PI_MOCKS_H
 
+#include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <vector>
 
 #define GPIO_OUT 1
@@ -11,21 +13,177 @@ typedef	unsigned int uint;
 
 extern std::vector<uint8_t> mockLastCommands;
 extern uint8_t mockLastCommand;
-extern int mockReadBitPos;
+extern size_t mockReadBitPos;
 extern size_t mockReadBitsLength;
 extern const char *mockReadBits;
 extern int writeCount;
+extern uint64_t mockTimeUs;
+
+typedef struct pio_hw {
+	int index;
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+typedef struct pio_program {
+	const uint16_t *instructions;
+	uint8_t length;
+	int8_t origin;
+} pio_program_t;
+
+enum clock_index {
+	clk_sys = 5
+};
+
+extern pio_hw_t mockPio0;
+extern pio_hw_t mockPio1;
+#define pio0 (&mockPio0)
+#define pio1 (&mockPio1)
+
+// Stand in for the pioasm generated one_wire.pio.h
+extern const pio_program_t onewire_program;
+#define onewire_offset_reset 0u
+#define onewire_offset_bit_loop 8u
+
+extern std::deque<uint32_t> mockPioRxFifo;
+extern bool mockPioAvailable;
+extern bool mockPioStrongPullup;
+extern int mockPioWordsWritten;
+extern float mockPioClkdiv;
+extern bool mockOverdrive;
+extern std::vector<uint8_t> mockPinCommands[30];// bytes written through the masked gpio functions, per pin
+extern void (*mockCore1Entry)();// the function launched on core 1 until it is reset, not run by the mocks
+
+class One_wire_sim;
+extern One_wire_sim *mockSimBus;// when set, mockSimPin is driven through the simulated bus instead of mockReadBits
+extern uint mockSimPin;
 
 void sleep_us(int us);
 
 void sleep_ms(int ms);
 
+uint64_t time_us_64();
+
+uint32_t time_us_32();
+
+void busy_wait_us_32(uint32_t delay_us);
+
+uint32_t save_and_disable_interrupts();
+
+void restore_interrupts(uint32_t status);
+
+/**
+ * Interrupt the mock code for length_us every period_us, an interrupt that
+ * comes due while interrupts are disabled runs when they are restored, unless
+ * it is unmaskable. A period of 0 stops the interrupts.
+ */
+void mockInterrupts(uint64_t period_us, uint64_t length_us, bool unmaskable = false);
+
+/**
+ * Interrupt the mock code for length_us straight after every every'th read of
+ * time_us_32, or when interrupts are next restored. An every of 0 stops them.
+ */
+void mockTimerReadInterrupts(uint32_t every, uint64_t length_us);
+
+extern uint64_t mockLongestMaskedUs;// the most time interrupts have been disabled
+
 void gpio_init(uint gpio);
 
+/**
+ * @returns the level an output pin drives, fails if the pin is not an output
+ */
+bool mockOutputHigh(uint gpio);
+
 void gpio_set_dir(uint gpio, bool out);
 
 bool gpio_get(uint gpio);
 
 void gpio_put(uint gpio, bool value);
 
+void gpio_put_masked(uint32_t mask, uint32_t value);
+
+void gpio_set_dir_masked(uint32_t mask, uint32_t value);
+
+uint32_t gpio_get_all();
+
+/**
+ * Stand in for one SIO GPIO register, writes and reads go through the mock gpio functions
+ */
+struct mock_sio_register_t {
+	void (*write)(uint32_t mask);
+	uint32_t (*read)();
+
+	mock_sio_register_t &operator=(uint32_t mask) {
+		write(mask);
+		return *this;
+	}
+
+	operator uint32_t() const { return read(); }
+};
+
+typedef struct {
+	mock_sio_register_t gpio_in;
+	mock_sio_register_t gpio_set;
+	mock_sio_register_t gpio_clr;
+	mock_sio_register_t gpio_oe_set;
+	mock_sio_register_t gpio_oe_clr;
+} sio_hw_t;
+
+extern sio_hw_t mockSio;
+#define sio_hw (&mockSio)
+
+void mockClearPinCommands();
+
+void multicore_reset_core1();
+
+void multicore_launch_core1(void (*entry)());
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past);
+
+bool cancel_alarm(alarm_id_t alarm_id);
+
+/**
+ * Advance the mock time to the earliest pending alarm and run its callback
+ *
+ * @returns false if no alarm is pending
+ */
+bool mockFireAlarm();
+
+size_t mockPendingAlarms();
+
+extern uint64_t mockLongestAlarmCallbackUs;// the most time an alarm callback has taken
+
+uint32_t clock_get_hz(enum clock_index clk_index);
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+
+uint pio_add_program(PIO pio, const pio_program_t *program);
+
+void pio_remove_program(PIO pio, const pio_program_t *program, uint loaded_offset);
+
+int pio_claim_unused_sm(PIO pio, bool required);
+
+void pio_sm_unclaim(PIO pio, uint sm);
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+
+void onewire_program_init(PIO pio, uint sm, uint offset, uint pin, float clkdiv);
+
+uint pio_encode_jmp(uint addr);
+
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm);
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask);
+
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div);
+
 #endif // PICO_PI_MOCKS_H
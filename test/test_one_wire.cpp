@@ -1,14 +1,33 @@
 #include <catch2/catch_test_macros.hpp>
 #include <cstdarg>
+#include <cmath>
 #include <cstring>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "one_wire.h"
-
-extern std::vector<rom_address_t> found_addresses;
+#include "one_wire_async.h"
+#include "one_wire_fixed.h"
+#include "one_wire_memory.h"
+#include "one_wire_multi.h"
+#include "one_wire_worker.h"
+#include "one_wire_sim.h"
 
 One_wire one_wire(0); //NOLINT
 
+// the baseline DS18B20 scratch pad as read bits, 16.3125 degC (0x0105) at 12 bits, CRC 0xCD
+#define BASELINE_SCRATCH_PAD_BITS \
+	"10100000" /*0x05*/ \
+	"10000000" /*0x01*/ \
+	"11010010" /*0x4B*/ \
+	"01100010" /*0x46*/ \
+	"11111110" /*0x7F*/ \
+	"11111111" /*0xFF*/ \
+	"11010000" /*0x0B*/ \
+	"00001000" /*0x10*/ \
+	"10110011" /*0xCD*/
+
 void resetLastCommands() {
 	mockLastCommand = 0;
 	mockLastCommands.clear();
@@ -24,24 +43,17 @@ void initialiseModule() {
 }
 
 void test_resolution(unsigned int resolution, uint8_t expected) {
-	initialiseModule();
+	One_wire bus(1);
 	resetLastCommands();
 
 	mockReadBitPos = 0;
-	//28 62 24 C7 03 00 00 0F
 	mockReadBits = "0"
-				   "00010100"
-				   "01000110"
-				   "00100100"
-				   "11100011"
-				   "11000000"
-				   "00000000"
-				   "00000000"
-				   "11110000";
+				   BASELINE_SCRATCH_PAD_BITS
+				   "0";
 	mockReadBitsLength = strlen(mockReadBits);
 
 	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
-	one_wire.set_resolution(address, resolution);
+	REQUIRE(bus.set_resolution(address, resolution));
 
 	REQUIRE(mockLastCommands[0] == MatchROMCommand);
 	REQUIRE(mockLastCommands[1] == 0x28);//address
@@ -52,9 +64,21 @@ void test_resolution(unsigned int resolution, uint8_t expected) {
 	REQUIRE(mockLastCommands[6] == 0x00);//address
 	REQUIRE(mockLastCommands[7] == 0x00);//address
 	REQUIRE(mockLastCommands[8] == 0x0F);//address
+	REQUIRE(mockLastCommands[9] == ReadScratchPadCommand);
+	REQUIRE(mockLastCommands[10] == MatchROMCommand);
+	REQUIRE(mockLastCommands[19] == WriteScratchPadCommand);
+	REQUIRE(mockLastCommands[20] == 0x4B);// alarm thresholds kept
+	REQUIRE(mockLastCommands[21] == 0x46);
+	REQUIRE(mockLastCommand == expected);
+	REQUIRE(bus.find_device(address)->resolution == resolution);
+
+	// the configuration is cached, a second change needs no read
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.set_resolution(address, resolution));
 	REQUIRE(mockLastCommands[9] == WriteScratchPadCommand);
-	REQUIRE(mockLastCommands[10] == 0x0);
-	REQUIRE(mockLastCommands[11] == 0x0);
 	REQUIRE(mockLastCommand == expected);
 }
 
@@ -66,19 +90,19 @@ TEST_CASE("Init", "[one_wire]") {
 }
 
 TEST_CASE("Set Resolution 9", "[one_wire]") {
-	test_resolution(9, 0x0);
+	test_resolution(9, 0x1F);
 }
 
 TEST_CASE("Set Resolution 10", "[one_wire]") {
-	test_resolution(10, 0x20);
+	test_resolution(10, 0x3F);
 }
 
 TEST_CASE("Set Resolution 11", "[one_wire]") {
-	test_resolution(11, 0x40);
+	test_resolution(11, 0x5F);
 }
 
 TEST_CASE("Set Resolution 12", "[one_wire]") {
-	test_resolution(12, 0x60);
+	test_resolution(12, 0x7F);
 }
 
 TEST_CASE("Read ROM", "[one_wire]") {
@@ -125,16 +149,7 @@ TEST_CASE("ReadTemperature", "[one_wire]") {
 	resetLastCommands();
 	mockReadBitPos = 0;
 	mockReadBits = "0"
-				   "10100000"//0x05
-				   "10000000"//0x01
-				   "11010010"//0x4B
-				   "01100010"//0x46
-				   "11111110"//0x7F
-				   "11111111"//0xFF
-				   "11010000"//0x0B
-				   "00001000"//0x10
-				   "10110011"//0xCD
-			;
+				   BASELINE_SCRATCH_PAD_BITS;
 	mockReadBitsLength = strlen(mockReadBits);
 
 	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
@@ -195,7 +210,6 @@ TEST_CASE("SearchROMSingleDevice", "[one_wire]") {
 	 * devices that match that address keep responding, so each time we have conflicting devices
 	 * we pick one and carry on.
 	 */
-	found_addresses.clear();
 	initialiseModule();
 	resetLastCommands();
 	mockReadBitPos = 0;
@@ -230,7 +244,7 @@ TEST_CASE("SearchROMSingleDevice", "[one_wire]") {
 	REQUIRE(mockLastCommands[7] == 0x00);
 	REQUIRE(mockLastCommand == 0x0F);
 
-	rom_address_t ROM_address = One_wire::get_address(0);
+	rom_address_t ROM_address = one_wire.get_address(0);
 	REQUIRE(ROM_address.rom[0] == 0x28);
 	REQUIRE(ROM_address.rom[1] == 0x62);
 	REQUIRE(ROM_address.rom[2] == 0x24);
@@ -242,7 +256,6 @@ TEST_CASE("SearchROMSingleDevice", "[one_wire]") {
 }
 
 TEST_CASE("SearchROMSecondDevice", "[one_wire]") {
-	found_addresses.clear();
 	initialiseModule();
 	resetLastCommands();
 	mockReadBitPos = 0;
@@ -298,7 +311,7 @@ TEST_CASE("SearchROMSecondDevice", "[one_wire]") {
 	REQUIRE(mockLastCommands[16] == 0x00);
 	REQUIRE(mockLastCommand == 0x0F);
 
-	rom_address_t ROM_address = One_wire::get_address(0);
+	rom_address_t ROM_address = one_wire.get_address(0);
 	REQUIRE(ROM_address.rom[0] == 0x28);
 	REQUIRE(ROM_address.rom[1] == 0x08);
 	REQUIRE(ROM_address.rom[2] == 0x81);
@@ -308,7 +321,7 @@ TEST_CASE("SearchROMSecondDevice", "[one_wire]") {
 	REQUIRE(ROM_address.rom[6] == 0x00);
 	REQUIRE(ROM_address.rom[7] == 0x26);
 
-	ROM_address = One_wire::get_address(1);
+	ROM_address = one_wire.get_address(1);
 	REQUIRE(ROM_address.rom[0] == 0x28);
 	REQUIRE(ROM_address.rom[1] == 0x62);
 	REQUIRE(ROM_address.rom[2] == 0x24);
@@ -321,7 +334,6 @@ TEST_CASE("SearchROMSecondDevice", "[one_wire]") {
 
 
 TEST_CASE("ListAllAttachedDevices", "[one_wire]") {
-	found_addresses.clear();
 	resetLastCommands();
 	mockReadBitPos = 0;
 	//28 08 81 FB 07 00 00 26 - first
@@ -357,7 +369,7 @@ TEST_CASE("ListAllAttachedDevices", "[one_wire]") {
 
 	one_wire.find_and_count_devices_on_bus();
 
-	rom_address_t ROM_address = One_wire::get_address(0);
+	rom_address_t ROM_address = one_wire.get_address(0);
 	REQUIRE(ROM_address.rom[0] == 0x28);
 	REQUIRE(ROM_address.rom[1] == 0x08);
 	REQUIRE(ROM_address.rom[2] == 0x81);
@@ -367,7 +379,7 @@ TEST_CASE("ListAllAttachedDevices", "[one_wire]") {
 	REQUIRE(ROM_address.rom[6] == 0x00);
 	REQUIRE(ROM_address.rom[7] == 0x26);
 
-	ROM_address = One_wire::get_address(1);
+	ROM_address = one_wire.get_address(1);
 	REQUIRE(ROM_address.rom[0] == 0x28);
 	REQUIRE(ROM_address.rom[1] == 0x62);
 	REQUIRE(ROM_address.rom[2] == 0x24);
@@ -376,4 +388,1732 @@ TEST_CASE("ListAllAttachedDevices", "[one_wire]") {
 	REQUIRE(ROM_address.rom[5] == 0x00);
 	REQUIRE(ROM_address.rom[6] == 0x00);
 	REQUIRE(ROM_address.rom[7] == 0x0F);
-}
\ No newline at end of file
+}
+TEST_CASE("PIOUnavailable", "[one_wire_pio]") {
+	One_wire pio_one_wire(1);
+	mockPioAvailable = false;
+	REQUIRE(pio_one_wire.use_pio(pio0) == false);
+	mockPioAvailable = true;
+}
+
+TEST_CASE("PIOReadTemperature", "[one_wire_pio]") {
+	One_wire pio_one_wire(1);
+	mockReadBitPos = 0;
+	mockReadBits = "01";
+	mockReadBitsLength = strlen(mockReadBits);
+	pio_one_wire.init();
+	REQUIRE(pio_one_wire.use_pio(pio0));
+	resetLastCommands();
+	mockPioWordsWritten = 0;
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   BASELINE_SCRATCH_PAD_BITS;
+	mockReadBitsLength = strlen(mockReadBits);
+
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	float temperature = pio_one_wire.temperature(address);
+	REQUIRE(temperature == 16.3125);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+	// match rom, 8 address bytes, read scratch pad, 9 bytes read
+	REQUIRE(mockPioWordsWritten == 19);
+	REQUIRE(mockLastCommands[0] == MatchROMCommand);
+	REQUIRE(mockLastCommands[1] == 0x28);
+	REQUIRE(mockLastCommands[2] == 0x62);
+	REQUIRE(mockLastCommands[3] == 0x24);
+	REQUIRE(mockLastCommands[4] == 0xC7);
+	REQUIRE(mockLastCommands[5] == 0x03);
+	REQUIRE(mockLastCommands[6] == 0x00);
+	REQUIRE(mockLastCommands[7] == 0x00);
+	REQUIRE(mockLastCommands[8] == 0x0F);
+	REQUIRE(mockLastCommand == ReadScratchPadCommand);
+	REQUIRE(mockPioRxFifo.empty());
+}
+
+TEST_CASE("PIOSearchROMSingleDevice", "[one_wire_pio]") {
+	One_wire pio_one_wire(1);
+	mockReadBitPos = 0;
+	mockReadBits = "01";
+	mockReadBitsLength = strlen(mockReadBits);
+	pio_one_wire.init();
+	REQUIRE(pio_one_wire.use_pio(pio0));
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   "0101011001100101"
+				   "0110010101101001"
+				   "0101100101100101"
+				   "1010100101011010"
+				   "1010010101010101"
+				   "0101010101010101"
+				   "0101010101010101"
+				   "1010101001010101"
+				   "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(pio_one_wire.find_and_count_devices_on_bus() == 1);
+	REQUIRE(mockLastCommands[0] == SearchROMCommand);
+	REQUIRE(mockLastCommand == 0x0F);
+	rom_address_t ROM_address = pio_one_wire.get_address(0);
+	REQUIRE(One_wire::to_uint64(ROM_address) == 0x286224C70300000FULL);
+}
+
+TEST_CASE("PIOParasitePowerConversion", "[one_wire_pio]") {
+	One_wire pio_one_wire(1);
+	mockReadBitPos = 0;
+	mockReadBits = "00";// presence, then parasite powered reply to read power supply
+	mockReadBitsLength = strlen(mockReadBits);
+	pio_one_wire.init();
+	REQUIRE(pio_one_wire.use_pio(pio0));
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t address{};
+	REQUIRE(pio_one_wire.convert_temperature(address, false, true) == 0);
+	REQUIRE(mockLastCommands[0] == SkipROMCommand);
+	REQUIRE(mockLastCommand == ConvertTempCommand);
+	REQUIRE(mockPioStrongPullup == false);
+}
+
+TEST_CASE("NonBlockingConversion", "[one_wire]") {
+	initialiseModule();
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   "0"
+				   BASELINE_SCRATCH_PAD_BITS;
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	uint64_t started = mockTimeUs;
+	REQUIRE(one_wire.start_conversion(address, true) == 750);
+	REQUIRE(mockTimeUs - started < 2000);
+	started = mockTimeUs;
+	REQUIRE(mockLastCommands[0] == SkipROMCommand);
+	REQUIRE(mockLastCommand == ConvertTempCommand);
+	REQUIRE(one_wire.conversion_ready(address) == false);
+
+	float temperature = 0;
+	REQUIRE(one_wire.collect_temperature(address, temperature) == false);
+	REQUIRE(mockReadBitPos == 1u);// nothing read while converting
+
+	mockTimeUs = started + 749999;
+	REQUIRE(one_wire.conversion_ready(address) == false);
+	mockTimeUs = started + 750000;
+	REQUIRE(one_wire.conversion_ready(address));
+	REQUIRE(one_wire.collect_temperature(address, temperature));
+	REQUIRE(temperature == 16.3125);
+}
+
+TEST_CASE("ConversionOfUnregisteredDevice", "[one_wire]") {
+	One_wire bus(1);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.start_conversion(address, false) == 750);
+	REQUIRE(mockLastCommand == ConvertTempCommand);
+	REQUIRE(bus.device_count() == 0);// the registry is left to the search
+	REQUIRE_FALSE(bus.conversion_ready(address));
+	mockTimeUs += 750000;
+	REQUIRE(bus.conversion_ready(address));
+
+	SECTION("nothing answers") {
+		resetLastCommands();
+		mockReadBitPos = 0;
+		mockReadBits = "1";
+		mockReadBitsLength = strlen(mockReadBits);
+		uint64_t started = mockTimeUs;
+		REQUIRE(bus.start_conversion(address, false) == One_wire::conversion_not_started);
+		REQUIRE(bus.convert_temperature(address, true, true) == One_wire::conversion_not_started);
+		REQUIRE(mockLastCommands.empty());// no Convert T sent
+		REQUIRE(mockLastCommand == 0);
+		REQUIRE(mockTimeUs - started < 2000);// nor waited for
+		REQUIRE(bus.conversion_ready(address));
+	}
+}
+
+TEST_CASE("ConversionPollingEndsEarly", "[one_wire]") {
+	initialiseModule();
+	one_wire.set_conversion_polling(true);
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   "00001";// converting for four read slots, then done
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t address{};
+	uint64_t started = mockTimeUs;
+	REQUIRE(one_wire.convert_temperature(address, true, true) == 0);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+	REQUIRE(mockTimeUs - started < 5000);
+	REQUIRE(mockLastCommands[0] == SkipROMCommand);
+	REQUIRE(mockLastCommand == ConvertTempCommand);
+	one_wire.set_conversion_polling(false);
+}
+
+TEST_CASE("ConversionPollingNonBlocking", "[one_wire]") {
+	initialiseModule();
+	one_wire.set_conversion_polling(true);
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   "01";
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t address{};
+	one_wire.start_conversion(address, true);
+	REQUIRE(one_wire.conversion_ready(address) == false);
+	REQUIRE(one_wire.conversion_ready(address));
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+	REQUIRE(one_wire.conversion_ready(address));// no further read slots once complete
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+	one_wire.set_conversion_polling(false);
+}
+
+TEST_CASE("ConversionPollingParasitePower", "[one_wire]") {
+	One_wire parasite_one_wire(1);
+	mockReadBitPos = 0;
+	mockReadBits = "00";// presence, then parasite powered reply to read power supply
+	mockReadBitsLength = strlen(mockReadBits);
+	parasite_one_wire.init();
+	parasite_one_wire.set_conversion_polling(true);
+	mockReadBitPos = 0;
+	mockReadBits = "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t address{};
+	uint64_t started = mockTimeUs;
+	REQUIRE(parasite_one_wire.convert_temperature(address, true, true) == 0);
+	REQUIRE(mockTimeUs - started >= 750000);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+}
+
+TEST_CASE("CRCCheckValues", "[one_wire_crc]") {
+	const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+	REQUIRE(One_wire_crc::crc8(check, sizeof(check)) == 0xA1);
+	REQUIRE(One_wire_crc::crc16(check, sizeof(check)) == 0xBB3D);
+
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	REQUIRE(One_wire_crc::crc8(address.rom, 7) == 0x0F);
+	REQUIRE(One_wire_crc::crc8(address.rom, 8) == 0);
+
+	const uint8_t inverted_crc[] = {0xC2, 0x44};// ~0xBB3D, LSB first
+	REQUIRE(One_wire_crc::crc16_valid(check, sizeof(check), inverted_crc));
+	REQUIRE(!One_wire_crc::crc16_valid(check, sizeof(check) - 1, inverted_crc));
+}
+
+TEST_CASE("DeviceRegistry", "[one_wire_registry]") {
+	Device_registry<3> registry;
+	rom_address_t first = One_wire::address_from_hex("286224C70300000F");
+	rom_address_t second = One_wire::address_from_hex("280881FB07000026");
+	rom_address_t third = One_wire::address_from_hex("10A1B2C3D4E5F600");
+	rom_address_t fourth = One_wire::address_from_hex("22A1B2C3D4E5F600");
+	REQUIRE(registry.capacity() == 3);
+	REQUIRE(registry.find(One_wire::to_uint64(first)) == nullptr);
+
+	device_info_t *entry = registry.add(first);
+	REQUIRE(entry != nullptr);
+	REQUIRE(entry->id == One_wire::to_uint64(first));
+	entry->conversion_deadline = 1234;
+	REQUIRE(registry.add(first) == entry);// already registered
+	REQUIRE(registry.add(second) != nullptr);
+	REQUIRE(registry.add(third) != nullptr);
+	REQUIRE(registry.add(fourth) == nullptr);// full
+	REQUIRE(registry.size() == 3);
+
+	REQUIRE(registry.remove(One_wire::to_uint64(first)));
+	REQUIRE(registry.remove(One_wire::to_uint64(first)) == false);
+	REQUIRE(registry.size() == 2);
+	REQUIRE(registry.find(One_wire::to_uint64(first)) == nullptr);
+	REQUIRE(registry.find(One_wire::to_uint64(second))->id == One_wire::to_uint64(second));
+	REQUIRE(registry.find(One_wire::to_uint64(third))->id == One_wire::to_uint64(third));
+	REQUIRE(registry.add(fourth)->conversion_deadline == 0);
+}
+
+TEST_CASE("SeparateBusRegistries", "[one_wire_registry]") {
+	// a supplied registry is the only one, the default registry is only in One_wire
+	REQUIRE(sizeof(One_wire_base) + sizeof(Device_registry<One_wire::default_max_devices>) <= sizeof(One_wire));
+	Device_registry<4> registry;
+	One_wire_base other_bus(registry, 1);
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   "0101011001100101"
+				   "0110010101101001"
+				   "0101100101100101"
+				   "1010100101011010"
+				   "1010010101010101"
+				   "0101010101010101"
+				   "0101010101010101"
+				   "1010101001010101"
+				   "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(other_bus.find_and_count_devices_on_bus() == 1);
+	REQUIRE(other_bus.device_count() == 1);
+	REQUIRE(registry.size() == 1);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	REQUIRE(other_bus.find_device(address) != nullptr);
+	REQUIRE(one_wire.find_device(address) != other_bus.find_device(address));
+}
+
+TEST_CASE("ReadAllDevices", "[one_wire]") {
+	Device_registry<4> registry;
+	One_wire_base bus(registry, 1);
+	registry.add(One_wire::address_from_hex("280881FB07000026"));
+	registry.add(One_wire::address_from_hex("286224C70300000F"));
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0"// convert
+				   "0"
+				   BASELINE_SCRATCH_PAD_BITS
+				   "0"
+				   "00001011"//0xD0
+				   "11100000"//0x07
+				   "11010010"//0x4B
+				   "01100010"//0x46
+				   "11111110"//0x7F
+				   "11111111"//0xFF
+				   "11010000"//0x0B
+				   "00001000"//0x10
+				   "01011000"//0x1A, bad crc
+			;
+	mockReadBitsLength = strlen(mockReadBits);
+
+	Bus_readings<2> readings;
+	REQUIRE(bus.read_all(readings) == 2);
+	REQUIRE(readings.count == 2);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+	REQUIRE(mockLastCommands[0] == SkipROMCommand);
+	REQUIRE(mockLastCommands[1] == ConvertTempCommand);
+	REQUIRE(mockLastCommands[2] == MatchROMCommand);
+	REQUIRE(mockLastCommands[3] == 0x28);
+	REQUIRE(mockLastCommands[4] == 0x08);
+	REQUIRE(mockLastCommands[11] == ReadScratchPadCommand);
+	REQUIRE(mockLastCommands[12] == MatchROMCommand);
+	REQUIRE(mockLastCommand == ReadScratchPadCommand);
+
+	REQUIRE(readings.ids[0] == 0x280881FB07000026ULL);
+	REQUIRE(readings.raw[0] == 0x0105);
+	REQUIRE(readings.crc_ok[0]);
+	REQUIRE(readings.ids[1] == 0x286224C70300000FULL);
+	REQUIRE(readings.raw[1] == 0x07D0);
+	REQUIRE(readings.crc_ok[1] == false);
+	REQUIRE(readings.timestamps[1] > readings.timestamps[0]);
+}
+
+TEST_CASE("FastRead", "[one_wire]") {
+	One_wire bus(1);
+	bus.set_fast_read(true, 2);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	const char *full_read = "0"
+							BASELINE_SCRATCH_PAD_BITS;
+	const char *fast_read = "0"
+							"00100000"//0x04
+							"10000000"//0x01
+							"0";      //reset to end the read
+
+	mockReadBitPos = 0;
+	mockReadBits = full_read;// first read is always in full
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.temperature(address) == 16.3125);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+
+	for (int i = 0; i < 2; i++) {
+		mockReadBitPos = 0;
+		mockReadBits = fast_read;
+		mockReadBitsLength = strlen(mockReadBits);
+		REQUIRE(bus.temperature(address) == 16.25);
+		REQUIRE(mockReadBitPos == mockReadBitsLength);
+	}
+
+	mockReadBitPos = 0;
+	mockReadBits = full_read;// interval reached
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.temperature(address) == 16.3125);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+	REQUIRE(bus.find_device(address)->reads_since_full_read == 0);
+}
+
+TEST_CASE("FastReadImplausible", "[one_wire]") {
+	One_wire bus(1);
+	bus.set_fast_read(true);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	const char *full_read = "0"
+							BASELINE_SCRATCH_PAD_BITS;
+	mockReadBitPos = 0;
+	mockReadBits = full_read;
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.temperature(address) == 16.3125);
+
+	// a jump of 16 degC is more than the allowed step
+	std::string jump_then_full = std::string("0"
+											 "10100000"//0x05
+											 "01000000"//0x02
+											 "0") + full_read;
+	mockReadBitPos = 0;
+	mockReadBits = jump_then_full.c_str();
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.temperature(address) == 16.3125);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+
+	// out of the device's range
+	std::string out_of_range_then_full = std::string("0"
+													 "00001111"//0xF0
+													 "11111110"//0x7F
+													 "0") + full_read;
+	mockReadBitPos = 0;
+	mockReadBits = out_of_range_then_full.c_str();
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.temperature(address) == 16.3125);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+}
+
+TEST_CASE("FastReadDroppedDevice", "[one_wire]") {
+	One_wire bus(1);
+	bus.set_fast_read(true);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	const char *zero_read = "0"
+							"00000000"//0x00
+							"00000000"//0x00
+							"11010010"//0x4B
+							"01100010"//0x46
+							"11111110"//0x7F
+							"11111111"//0xFF
+							"00110000"//0x0C
+							"00001000"//0x10
+							"00010011";//0xC8
+	mockReadBitPos = 0;
+	mockReadBits = zero_read;
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.temperature(address) == 0.0f);
+
+	// another device answers the presence, the selected one is gone and reads 0xFFFF,
+	// only one step from 0 degC but never taken as -0.0625
+	std::string dropped_then_full = std::string("0"
+												"11111111"//0xFF
+												"11111111"//0xFF
+												"0") + zero_read;
+	mockReadBitPos = 0;
+	mockReadBits = dropped_then_full.c_str();
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.temperature(address) == 0.0f);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+}
+
+TEST_CASE("FastReadNoPresence", "[one_wire]") {
+	One_wire bus(1);
+	bus.set_fast_read(true);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	const char *full_read = "0"
+							BASELINE_SCRATCH_PAD_BITS;
+	mockReadBitPos = 0;
+	mockReadBits = full_read;
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.temperature(address) == 16.3125);
+
+	// no presence for the fast read, so it is not attempted
+	std::string missing_then_full = std::string("1") + full_read;
+	mockReadBitPos = 0;
+	mockReadBits = missing_then_full.c_str();
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.temperature(address) == 16.3125);
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+}
+
+TEST_CASE("OverdriveMatchROM", "[one_wire]") {
+	One_wire bus(1);
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0"// overdrive match rom
+				   "0"
+				   BASELINE_SCRATCH_PAD_BITS;
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	REQUIRE(bus.overdrive_match_rom(address));
+	REQUIRE(bus.overdrive());
+	REQUIRE(mockOverdrive);
+	uint64_t started = mockTimeUs;
+	REQUIRE(bus.temperature(address) == 16.3125);
+	REQUIRE(mockTimeUs - started < 2000);// ~90 slots at overdrive speed
+	REQUIRE(mockOverdrive);
+	REQUIRE(mockLastCommands[0] == OverdriveMatchROMCommand);
+	REQUIRE(mockLastCommands[1] == 0x28);
+	REQUIRE(mockLastCommands[8] == 0x0F);
+	REQUIRE(mockLastCommands[9] == MatchROMCommand);
+	REQUIRE(mockLastCommands[10] == 0x28);
+	REQUIRE(mockLastCommands[17] == 0x0F);
+	REQUIRE(mockLastCommand == ReadScratchPadCommand);
+
+	bus.set_standard_speed();
+	mockReadBitPos = 0;
+	mockReadBits = "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t read_address{};
+	bus.single_device_read_rom(read_address);
+	REQUIRE(mockOverdrive == false);
+}
+
+TEST_CASE("OverdriveFallback", "[one_wire]") {
+	One_wire bus(1);
+	mockReadBitPos = 0;
+	mockReadBits = "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.overdrive_skip_rom());
+	REQUIRE(bus.overdrive());
+	REQUIRE(mockOverdrive);
+
+	mockOverdrive = false;// device replaced by one without overdrive
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   BASELINE_SCRATCH_PAD_BITS;
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	REQUIRE(bus.temperature(address) == 16.3125);
+	REQUIRE(bus.overdrive() == false);
+	REQUIRE(mockLastCommands[0] == MatchROMCommand);
+}
+
+TEST_CASE("PIOOverdrive", "[one_wire_pio]") {
+	One_wire pio_one_wire(1);
+	REQUIRE(pio_one_wire.use_pio(pio0));
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(pio_one_wire.overdrive_skip_rom());
+	REQUIRE(mockPioClkdiv == 125.0f / One_wire_pio::overdrive_speedup);
+	REQUIRE(mockOverdrive);
+	REQUIRE(mockLastCommand == OverdriveSkipROMCommand);
+	pio_one_wire.set_standard_speed();
+	REQUIRE(mockPioClkdiv == 125.0f);
+}
+
+TEST_CASE("SetAlarmThresholds", "[one_wire]") {
+	One_wire bus(1);
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   BASELINE_SCRATCH_PAD_BITS
+				   "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	REQUIRE(bus.set_alarm_thresholds(address, 30, -10));
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+	REQUIRE(mockLastCommands[9] == ReadScratchPadCommand);
+	REQUIRE(mockLastCommands[10] == MatchROMCommand);
+	REQUIRE(mockLastCommands[19] == WriteScratchPadCommand);
+	REQUIRE(mockLastCommands[20] == 30);
+	REQUIRE(mockLastCommands[21] == (uint8_t) -10);
+	REQUIRE(mockLastCommand == 0x7F);// configuration unchanged
+
+	rom_address_t unsupported = One_wire::address_from_hex("09A1B2C3D4E5F600");
+	REQUIRE(bus.set_alarm_thresholds(unsupported, 30, -10) == false);
+}
+
+TEST_CASE("AlarmSearch", "[one_wire]") {
+	One_wire bus(1);
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   "0101011001100101"
+				   "0110010101101001"
+				   "0101100101100101"
+				   "1010100101011010"
+				   "1010010101010101"
+				   "0101010101010101"
+				   "0101010101010101"
+				   "1010101001010101"
+				   "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	rom_address_t alarmed[4];
+	REQUIRE(bus.find_alarmed_devices(alarmed, 4) == 1);
+	REQUIRE(mockLastCommands[0] == AlarmSearchCommand);
+	REQUIRE(One_wire::to_uint64(alarmed[0]) == 0x286224C70300000FULL);
+	REQUIRE(bus.device_count() == 0);
+
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   "11";// nobody in alarm
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.find_alarmed_devices(alarmed, 4) == 0);
+}
+
+TEST_CASE("ResumableSearch", "[one_wire]") {
+	One_wire bus(1);
+	resetLastCommands();
+	mockReadBitPos = 0;
+	//28 08 81 FB 07 00 00 26 - first
+	//28 62 24 C7 03 00 00 0F - second
+	mockReadBits = "0"
+				   "0101011001100101"
+				   "0100011001010101"
+				   "1001010101010110"
+				   "1010011010101010"
+				   "1010100101010101"
+				   "0101010101010101"
+				   "0101010101010101"
+				   "0110100101100101"
+				   "0"
+				   "0101011001100101"
+				   "0100010101101001"
+				   "0101100101100101"
+				   "1010100101011010"
+				   "1010010101010101"
+				   "0101010101010101"
+				   "0101010101010101"
+				   "1010101001010101";
+	mockReadBitsLength = strlen(mockReadBits);
+	search_state_t search;
+	rom_address_t address{};
+	One_wire::search_begin(search);
+	REQUIRE(bus.search_next(search, address));
+	REQUIRE(One_wire::to_uint64(address) == 0x280881FB07000026ULL);
+	REQUIRE(mockReadBitPos == 129u);
+	REQUIRE(bus.search_next(search, address));
+	REQUIRE(One_wire::to_uint64(address) == 0x286224C70300000FULL);
+	REQUIRE(search.last_device);
+	REQUIRE_FALSE(bus.search_next(search, address));
+	REQUIRE(mockReadBitPos == 258u);
+	REQUIRE(bus.device_count() == 0);
+}
+
+TEST_CASE("FamilySearch", "[one_wire]") {
+	One_wire bus(1);
+	rom_address_t found[4];
+	const char *two_devices = "0"
+							  "0101011001100101"
+							  "0100011001010101"
+							  "1001010101010110"
+							  "1010011010101010"
+							  "1010100101010101"
+							  "0101010101010101"
+							  "0101010101010101"
+							  "0110100101100101"
+							  "0"
+							  "0101011001100101"
+							  "0100010101101001"
+							  "0101100101100101"
+							  "1010100101011010"
+							  "1010010101010101"
+							  "0101010101010101"
+							  "0101010101010101"
+							  "1010101001010101";
+
+	SECTION("all of the family") {
+		mockReadBitPos = 0;
+		mockReadBits = two_devices;
+		mockReadBitsLength = strlen(mockReadBits);
+		REQUIRE(bus.find_devices_of_family(FAMILY_CODE_DS18B20, found, 4) == 2);
+		REQUIRE(One_wire::to_uint64(found[0]) == 0x280881FB07000026ULL);
+		REQUIRE(One_wire::to_uint64(found[1]) == 0x286224C70300000FULL);
+	}
+
+	SECTION("stop after the first device") {
+		mockReadBitPos = 0;
+		mockReadBits = two_devices;
+		mockReadBitsLength = strlen(mockReadBits);
+		REQUIRE(bus.find_devices_of_family(FAMILY_CODE_DS18B20, found, 1) == 1);
+		REQUIRE(One_wire::to_uint64(found[0]) == 0x280881FB07000026ULL);
+		REQUIRE(mockReadBitPos == 129u);
+	}
+
+	SECTION("family not on the bus") {
+		resetLastCommands();
+		mockReadBitPos = 0;
+		mockReadBits = two_devices;
+		mockReadBitsLength = strlen(mockReadBits);
+		REQUIRE(bus.find_devices_of_family(FAMILY_CODE_DS18S20, found, 4) == 0);
+		// gave up once the family byte was passed
+		REQUIRE(mockReadBitPos == 17u);
+		REQUIRE(mockLastCommands[0] == SearchROMCommand);
+		REQUIRE(mockLastCommand == 0x28);
+	}
+}
+
+TEST_CASE("Rescan", "[one_wire_sim]") {
+	Sim_thermometer first(FAMILY_CODE_DS18B20, 1);
+	Sim_thermometer second(FAMILY_CODE_DS18B20, 2);
+	Sim_ds2502 memory(3);
+	One_wire_sim sim;
+	sim.add(first);
+	sim.add(second);
+	sim.add(memory);
+	sim.attach(2);
+	Device_registry<4> registry;
+	One_wire_base bus(registry, 2);
+	Bus_changes<4> changes;
+	bus.init();
+	REQUIRE(bus.find_and_count_devices_on_bus() == 3);
+	rom_address_t first_address = first.rom();
+	bus.find_device(first_address)->last_raw = 0x0191;
+	uint64_t resets = sim.resets;
+
+	SECTION("nothing changed on a mixed bus") {
+		REQUIRE(bus.rescan(changes) == 3);
+		REQUIRE(changes.added_count == 0);
+		REQUIRE(changes.removed_count == 0);
+		REQUIRE(sim.resets - resets == 3);// one seeded search pass per device, no full search
+		REQUIRE(bus.find_device(first_address)->last_raw == 0x0191);
+	}
+
+	SECTION("device removed") {
+		sim.clear();
+		sim.add(first);
+		sim.add(memory);
+		REQUIRE(bus.rescan(changes) == 2);
+		REQUIRE(changes.added_count == 0);
+		REQUIRE(changes.removed_count == 1);
+		REQUIRE(One_wire::to_uint64(changes.removed[0]) == second.id());
+		REQUIRE(sim.resets - resets == 3 + 2);// the full search starts with its own reset
+		REQUIRE(bus.find_device(first_address)->last_raw == 0x0191);
+	}
+
+	SECTION("every device gone, then back") {
+		sim.clear();
+		REQUIRE(bus.rescan(changes) == 0);
+		REQUIRE(changes.removed_count == 3);
+		REQUIRE(registry.size() == 0);
+
+		sim.add(first);
+		sim.add(second);
+		sim.add(memory);
+		REQUIRE(bus.rescan(changes) == 3);
+		REQUIRE(changes.added_count == 3);
+		REQUIRE(changes.removed_count == 0);
+	}
+
+	SECTION("periodic full search finds an added device") {
+		sim.clear();
+		sim.add(first);
+		sim.add(memory);
+		REQUIRE(bus.rescan(changes) == 2);
+		bus.set_full_search_interval(2);
+		sim.add(second);
+		REQUIRE(bus.rescan(changes) == 2);
+		REQUIRE(bus.rescan(changes) == 3);
+		REQUIRE(changes.added_count == 1);
+		REQUIRE(One_wire::to_uint64(changes.added[0]) == second.id());
+		REQUIRE(changes.removed_count == 0);
+	}
+	sim.detach();
+}
+
+TEST_CASE("DeviceConfigCache", "[one_wire]") {
+	One_wire bus(1);
+	mockReadBitPos = 0;
+	mockReadBits = "00";// parasite powered devices on the bus
+	mockReadBitsLength = strlen(mockReadBits);
+	bus.init();
+
+	rom_address_t address = One_wire::address_from_hex("286224C70300000F");
+	resetLastCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "0"
+				   "00001010"//0x50
+				   "10100000"//0x05
+				   "11010010"//0x4B
+				   "01100010"//0x46
+				   "11111000"//0x1F
+				   "11111111"//0xFF
+				   "00110000"//0x0C
+				   "00001000"//0x10
+				   "00110001"//0x8C
+				   "0"
+				   "1";// this device has its own supply
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.read_device_config(address));
+	REQUIRE(mockReadBitPos == mockReadBitsLength);
+	REQUIRE(mockLastCommand == ReadPowerSupplyCommand);
+	device_info_t *device = bus.find_device(address);
+	REQUIRE(device->resolution == 9);
+	REQUIRE(device->alarm_high == 75);
+	REQUIRE(device->alarm_low == 70);
+	REQUIRE_FALSE(device->parasite_powered);
+
+	// cached, nothing more to read
+	resetLastCommands();
+	REQUIRE(bus.read_device_config(address));
+	REQUIRE(mockLastCommands.empty());
+
+	// a 9 bit conversion without the strong pull up, so the call does not wait
+	mockReadBitPos = 0;
+	mockReadBits = "0";
+	mockReadBitsLength = strlen(mockReadBits);
+	REQUIRE(bus.convert_temperature(address, false, false) == 94);
+
+	// an uncached device waits for the longest conversion
+	rom_address_t other = One_wire::address_from_hex("280881FB07000026");
+	mockReadBitPos = 0;
+	uint64_t before = mockTimeUs;
+	REQUIRE(bus.convert_temperature(other, false, false) == 0);// parasite powered so waited
+	REQUIRE(mockTimeUs - before >= 750000);
+}
+
+// read slot bits for two buses sampled together, bus 0 then bus 1 in each slot
+static std::string interleave_bytes(const uint8_t *bus_0, const uint8_t *bus_1, size_t length) {
+	std::string bits;
+	for (size_t byte = 0; byte < length; byte++) {
+		for (int bit = 0; bit < 8; bit++) {
+			bits += (bus_0[byte] & (1 << bit)) ? '1' : '0';
+			bits += (bus_1[byte] & (1 << bit)) ? '1' : '0';
+		}
+	}
+	return bits;
+}
+
+TEST_CASE("MultiBus", "[one_wire_multi]") {
+	const uint pins[] = {10, 11};
+	One_wire_multi buses(pins, 2);
+	mockClearPinCommands();
+	mockReadBitPos = 0;
+	mockReadBits = "00"// both buses present
+				   "10";// bus 1 is parasite powered
+	mockReadBitsLength = strlen(mockReadBits);
+	buses.init();
+	REQUIRE(mockReadBitPos == 4u);
+	REQUIRE(buses.parasite_buses() == 0x2);
+	REQUIRE(mockPinCommands[10] == std::vector<uint8_t>{SkipROMCommand, ReadPowerSupplyCommand});
+	REQUIRE(mockPinCommands[11] == std::vector<uint8_t>{SkipROMCommand, ReadPowerSupplyCommand});
+
+	SECTION("convert on every bus at once") {
+		mockClearPinCommands();
+		mockReadBitPos = 0;
+		mockReadBits = "01";// only bus 0 answers
+		mockReadBitsLength = strlen(mockReadBits);
+		uint64_t before = mockTimeUs;
+		REQUIRE(buses.convert_temperature() == 0x1);
+		REQUIRE(mockPinCommands[10] == std::vector<uint8_t>{SkipROMCommand, ConvertTempCommand});
+		REQUIRE(mockPinCommands[11] == std::vector<uint8_t>{SkipROMCommand, ConvertTempCommand});
+		// one reset, two bytes and the conversion, no matter how many buses
+		REQUIRE(mockTimeUs - before < 750000 + 2500);
+	}
+
+	SECTION("read a different device on each bus") {
+		rom_address_t addresses[2] = {One_wire::address_from_hex("280881FB07000026"),
+									  One_wire::address_from_hex("286224C70300000F")};
+		const uint8_t scratch_pad_0[ScratchPadSize] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0x1C};
+		uint8_t scratch_pad_1[ScratchPadSize] = {0x05, 0x01, 0x4B, 0x46, 0x7F, 0xFF, 0x0B, 0x10, 0xCD};
+		uint8_t scratch_pads[2][ScratchPadSize];
+
+		mockClearPinCommands();
+		std::string bits = "00" + interleave_bytes(scratch_pad_0, scratch_pad_1, ScratchPadSize);
+		mockReadBitPos = 0;
+		mockReadBits = bits.c_str();
+		mockReadBitsLength = bits.length();
+		REQUIRE(buses.read_scratch_pads(scratch_pads, addresses) == 0x3);
+		REQUIRE(mockReadBitPos == bits.length());
+		REQUIRE(memcmp(scratch_pads[0], scratch_pad_0, ScratchPadSize) == 0);
+		REQUIRE(memcmp(scratch_pads[1], scratch_pad_1, ScratchPadSize) == 0);
+		REQUIRE(mockPinCommands[10] == std::vector<uint8_t>{MatchROMCommand, 0x28, 0x08, 0x81, 0xFB, 0x07, 0x00, 0x00, 0x26, ReadScratchPadCommand});
+		REQUIRE(mockPinCommands[11] == std::vector<uint8_t>{MatchROMCommand, 0x28, 0x62, 0x24, 0xC7, 0x03, 0x00, 0x00, 0x0F, ReadScratchPadCommand});
+
+		scratch_pad_1[0] ^= 0x01;// corrupted on bus 1
+		bits = "00" + interleave_bytes(scratch_pad_0, scratch_pad_1, ScratchPadSize);
+		mockReadBitPos = 0;
+		mockReadBits = bits.c_str();
+		mockReadBitsLength = bits.length();
+		REQUIRE(buses.read_scratch_pads(scratch_pads) == 0x1);
+	}
+}
+
+TEST_CASE("ReadingQueueThreaded", "[one_wire_queue]") {
+	static Reading_queue<16> queue;// small, so both sides keep meeting full and empty
+	const uint32_t total = 200000;
+	REQUIRE(queue.capacity() == 16);
+
+	std::thread producer([&]() {
+		for (uint32_t i = 0; i < total; i++) {
+			reading_t reading{i, (uint64_t) i * 3, (int16_t) (i & 0x7FFF), (i & 1) != 0};
+			while (!queue.push(reading)) {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	uint32_t expected = 0;
+	bool in_order = true;
+	while (expected < total) {
+		reading_t reading{};
+		if (!queue.pop(reading)) {
+			std::this_thread::yield();
+			continue;
+		}
+		// every field must come from the same push, in push order
+		in_order = in_order && reading.id == expected && reading.timestamp == (uint64_t) expected * 3 &&
+				   reading.raw == (int16_t) (expected & 0x7FFF) && reading.crc_ok == ((expected & 1) != 0);
+		expected++;
+	}
+	producer.join();
+	REQUIRE(in_order);
+	REQUIRE(queue.size() == 0);
+	reading_t reading{};
+	REQUIRE_FALSE(queue.pop(reading));
+}
+
+TEST_CASE("BusWorker", "[one_wire_worker]") {
+	Device_registry<4> registry;
+	One_wire_base bus(registry, 1);
+	One_wire_worker<2> worker(bus, 1000);
+	mockCore1Entry = nullptr;
+	REQUIRE(worker.start());
+	REQUIRE(mockCore1Entry != nullptr);
+	REQUIRE_FALSE(worker.stopped());
+	One_wire_worker<2> second(bus, 1000);
+	REQUIRE_FALSE(second.start());// core 1 is taken
+
+	std::string scratch_pad = "0"
+							  "0"
+							  BASELINE_SCRATCH_PAD_BITS;
+	std::string bits = std::string("0"
+								   "0101011001100101"
+								   "0110010101101001"
+								   "0101100101100101"
+								   "1010100101011010"
+								   "1010010101010101"
+								   "0101010101010101"
+								   "0101010101010101"
+								   "1010101001010101") +
+					   scratch_pad + scratch_pad + scratch_pad;
+	mockReadBitPos = 0;
+	mockReadBits = bits.c_str();
+	mockReadBitsLength = bits.length();
+
+	// the first cycle enumerates then reads
+	worker.step();
+	REQUIRE(registry.size() == 1);
+	reading_t reading{};
+	REQUIRE(worker.pop(reading));
+	REQUIRE(reading.id == 0x286224C70300000FULL);
+	REQUIRE(reading.raw == 0x0105);
+	REQUIRE(reading.crc_ok);
+	REQUIRE_FALSE(worker.pop(reading));
+
+	// later cycles keep to the period
+	uint64_t first = reading.timestamp;
+	worker.step();
+	worker.step();
+	REQUIRE(worker.dropped() == 0);
+	REQUIRE(worker.pop(reading));
+	REQUIRE(reading.timestamp - first >= 1000000);
+	REQUIRE(reading.timestamp - first < 1100000);
+	REQUIRE(worker.pop(reading));
+	REQUIRE_FALSE(worker.pop(reading));
+
+	// core 1 sees the stop request and gives the core back
+	worker.stop();
+	mockCore1Entry();
+	REQUIRE(worker.stopped());
+	REQUIRE(second.start());
+	second.stop();
+	mockCore1Entry();
+
+	// and can be launched again by the same worker
+	REQUIRE(worker.start());
+	REQUIRE_FALSE(worker.stopped());
+	worker.stop();
+	mockCore1Entry();
+	REQUIRE(worker.stopped());
+	multicore_reset_core1();
+}
+
+static void count_completion(bus_readings_t &readings, void *user_data) {
+	(*(int *) user_data)++;
+}
+
+TEST_CASE("AlarmDrivenReadAll", "[one_wire_async]") {
+	Device_registry<4> registry;
+	One_wire_base bus(registry, 1);
+	One_wire_async async_bus(bus);
+	Bus_readings<4> readings;
+	int completions = 0;
+
+	SECTION("every device read") {
+		registry.add(One_wire::address_from_hex("280881FB07000026"));
+		registry.add(One_wire::address_from_hex("286224C70300000F"));
+		resetLastCommands();
+		mockReadBitPos = 0;
+		mockReadBits = "0"// convert
+					   "0"
+					   BASELINE_SCRATCH_PAD_BITS
+					   "0"
+					   "00001011"//0xD0
+					   "11100000"//0x07
+					   "11010010"//0x4B
+					   "01100010"//0x46
+					   "11111110"//0x7F
+					   "11111111"//0xFF
+					   "11010000"//0x0B
+					   "00001000"//0x10
+					   "01011000"//0x1A, bad crc
+				;
+		mockReadBitsLength = strlen(mockReadBits);
+
+		uint64_t started = mockTimeUs;
+		REQUIRE(async_bus.start_read_all(readings, count_completion, &completions));
+		REQUIRE(mockTimeUs - started < 10);// only the reset pulse has begun
+		REQUIRE(async_bus.busy());
+		REQUIRE_FALSE(async_bus.start_read_all(readings));
+		REQUIRE(mockPendingAlarms() == 1);
+
+		int alarms = 0;
+		while (mockFireAlarm()) {
+			alarms++;
+		}
+		REQUIRE_FALSE(async_bus.busy());
+		REQUIRE(completions == 1);
+		// low, presence sample and recovery of three resets, the conversion, and one per
+		// byte (Skip ROM and Convert T, then 10 out and 9 in for each device)
+		REQUIRE(alarms == 3 * 3 + 1 + 2 + 2 * 19);
+		REQUIRE(mockTimeUs - started >= 750000);
+		REQUIRE(mockReadBitPos == mockReadBitsLength);
+		REQUIRE(mockLastCommands[0] == SkipROMCommand);
+		REQUIRE(mockLastCommands[1] == ConvertTempCommand);
+		REQUIRE(mockLastCommands[2] == MatchROMCommand);
+		REQUIRE(mockLastCommands[11] == ReadScratchPadCommand);
+		REQUIRE(mockLastCommands[12] == MatchROMCommand);
+		REQUIRE(mockLastCommand == ReadScratchPadCommand);
+
+		REQUIRE(readings.count == 2);
+		REQUIRE(readings.ids[0] == 0x280881FB07000026ULL);
+		REQUIRE(readings.raw[0] == 0x0105);
+		REQUIRE(readings.crc_ok[0]);
+		REQUIRE(readings.ids[1] == 0x286224C70300000FULL);
+		REQUIRE(readings.raw[1] == 0x07D0);
+		REQUIRE_FALSE(readings.crc_ok[1]);
+	}
+
+	SECTION("nobody present") {
+		registry.add(One_wire::address_from_hex("280881FB07000026"));
+		mockReadBitPos = 0;
+		mockReadBits = "1";
+		mockReadBitsLength = strlen(mockReadBits);
+		readings.count = 1;
+		REQUIRE(async_bus.start_read_all(readings, count_completion, &completions));
+		while (mockFireAlarm()) {
+		}
+		REQUIRE(completions == 1);
+		REQUIRE(readings.count == 0);
+	}
+
+	SECTION("cancelled") {
+		mockReadBitPos = 0;
+		mockReadBits = "0";
+		mockReadBitsLength = strlen(mockReadBits);
+		REQUIRE(async_bus.start_read_all(readings, count_completion, &completions));
+		async_bus.cancel();
+		REQUIRE_FALSE(async_bus.busy());
+		REQUIRE(mockPendingAlarms() == 0);
+		REQUIRE(completions == 0);
+	}
+}
+
+TEST_CASE("AlarmDrivenResetTiming", "[one_wire_sim]") {
+	std::vector<Sim_thermometer> devices;
+	for (int i = 0; i < 3; i++) {
+		devices.emplace_back(FAMILY_CODE_DS18B20, 40 + i);
+		devices.back().set_temperature(18000 + i * 500);
+	}
+	One_wire_sim sim;
+	for (Sim_thermometer &device : devices) {
+		sim.add(device);
+	}
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	REQUIRE(bus.find_and_count_devices_on_bus() == 3);
+	One_wire_async async_bus(bus);
+	Bus_readings<4> readings;
+
+	sim.shortest_reset_low = UINT64_MAX;
+	sim.shortest_reset_recovery = UINT64_MAX;
+	uint64_t resets = sim.resets;
+	REQUIRE(async_bus.start_read_all(readings));
+	mockLongestAlarmCallbackUs = 0;
+	while (mockFireAlarm()) {
+	}
+	REQUIRE_FALSE(async_bus.busy());
+	REQUIRE(readings.count == 3);
+	REQUIRE(sim.resets == resets + 4);// Convert T, then one per device
+	REQUIRE(sim.shortest_reset_low >= 480);
+	REQUIRE(sim.shortest_reset_recovery >= 480);
+	for (size_t i = 0; i < 3; i++) {
+		REQUIRE(readings.crc_ok[i]);
+		for (Sim_thermometer &device : devices) {
+			if (device.id() == readings.ids[i]) {
+				REQUIRE(readings.raw[i] == (18000 + (&device - &devices[0]) * 500) * 16 / 1000);
+			}
+		}
+	}
+	// a byte of slots at most, never a whole device read, in the timer interrupt
+	REQUIRE(mockLongestAlarmCallbackUs < 1000);
+	sim.detach();
+}
+
+static uint64_t next_serial(uint64_t &seed) {
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return seed >> 16;
+}
+
+TEST_CASE("SimulatedSearch", "[one_wire_sim]") {
+	const uint8_t families[] = {FAMILY_CODE_DS18B20, FAMILY_CODE_DS18S20, FAMILY_CODE_DS1822, FAMILY_CODE_MAX31826};
+	std::vector<Sim_thermometer> devices;
+	uint64_t seed = 1;
+	for (int i = 0; i < 100; i++) {
+		devices.emplace_back(families[i % 4], next_serial(seed));
+	}
+	One_wire_sim sim;
+	for (Sim_thermometer &device : devices) {
+		sim.add(device);
+	}
+	sim.attach(2);
+	Device_registry<128> registry;
+	One_wire_base bus(registry, 2);
+	bus.init();
+
+	SECTION("bit banged") {
+		REQUIRE(bus.find_and_count_devices_on_bus() == 100);
+	}
+	SECTION("PIO") {
+		REQUIRE(bus.use_pio(pio0));
+		REQUIRE(bus.find_and_count_devices_on_bus() == 100);
+	}
+	for (Sim_thermometer &device : devices) {
+		rom_address_t address = device.rom();
+		REQUIRE(bus.find_device(address) != nullptr);
+	}
+
+	rom_address_t found[100];
+	REQUIRE(bus.find_devices_of_family(FAMILY_CODE_DS1822, found, 100) == 25);
+	for (int i = 0; i < 25; i++) {
+		REQUIRE(found[i].rom[0] == FAMILY_CODE_DS1822);
+	}
+	sim.detach();
+}
+
+TEST_CASE("SimulatedTemperatures", "[one_wire_sim]") {
+	Sim_thermometer ds18b20(FAMILY_CODE_DS18B20, 1);
+	Sim_thermometer ds18s20(FAMILY_CODE_DS18S20, 2);
+	Sim_thermometer ds1822(FAMILY_CODE_DS1822, 3);
+	Sim_thermometer max31826(FAMILY_CODE_MAX31826, 4);
+	ds18b20.set_temperature(21375);
+	ds18s20.set_temperature(-10250);
+	ds1822.set_temperature(-55000);
+	max31826.set_temperature(125000);
+	One_wire_sim sim;
+	sim.add(ds18b20);
+	sim.add(ds18s20);
+	sim.add(ds1822);
+	sim.add(max31826);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	REQUIRE(bus.find_and_count_devices_on_bus() == 4);
+
+	rom_address_t address{};
+	uint64_t started = mockTimeUs;
+	REQUIRE(bus.convert_temperature(address, true, true) == 0);
+	REQUIRE(mockTimeUs - started >= 750000);
+	REQUIRE(ds18b20.conversions == 1);
+	REQUIRE(max31826.conversions == 1);
+
+	address = ds18b20.rom();
+	REQUIRE(bus.temperature(address) == 21.375f);
+	address = ds18s20.rom();
+	REQUIRE(bus.temperature(address) == -10.25f);
+	address = ds1822.rom();
+	REQUIRE(bus.temperature(address) == -55.0f);
+	address = max31826.rom();
+	REQUIRE(bus.temperature(address) == 125.0f);
+
+	// a device that has been removed reads as a CRC error
+	sim.clear();
+	address = ds18b20.rom();
+	REQUIRE(bus.temperature(address) == (float) One_wire::invalid_conversion);
+	sim.detach();
+}
+
+TEST_CASE("SimulatedConversionPolling", "[one_wire_sim]") {
+	Sim_thermometer device(FAMILY_CODE_DS18B20, 5);
+	device.set_temperature(30500);
+	One_wire_sim sim;
+	sim.add(device);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	REQUIRE(bus.find_and_count_devices_on_bus() == 1);
+	bus.set_conversion_polling(true);
+	rom_address_t address = device.rom();
+
+	// a typical device finishes well before the datasheet maximum
+	uint64_t started = mockTimeUs;
+	bus.convert_temperature(address, true, false);
+	uint64_t typical = mockTimeUs - started;
+	REQUIRE(typical >= 600000);
+	REQUIRE(typical < 607000);// plus the Match ROM and Convert T slots
+
+	device.set_conversion_percent(100);
+	started = mockTimeUs;
+	bus.convert_temperature(address, true, false);
+	uint64_t twelve_bit = mockTimeUs - started;
+	REQUIRE(twelve_bit >= 750000);
+	REQUIRE(twelve_bit < 757000);
+
+	REQUIRE(bus.set_resolution(address, 9));
+	REQUIRE(device.scratch_pad()[4] == 0x1F);
+	started = mockTimeUs;
+	bus.convert_temperature(address, true, false);
+	uint64_t nine_bit = mockTimeUs - started;
+	REQUIRE(nine_bit >= 93750);
+	REQUIRE(nine_bit < 101000);
+	REQUIRE(bus.temperature(address) == 30.5f);
+	sim.detach();
+}
+
+TEST_CASE("SimulatedAlarmSearch", "[one_wire_sim]") {
+	Sim_thermometer cold(FAMILY_CODE_DS18B20, 6);
+	Sim_thermometer warm(FAMILY_CODE_DS18B20, 7);
+	Sim_thermometer hot(FAMILY_CODE_DS18B20, 8);
+	cold.set_temperature(-5000);
+	warm.set_temperature(20000);
+	hot.set_temperature(40000);
+	One_wire_sim sim;
+	sim.add(cold);
+	sim.add(warm);
+	sim.add(hot);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	REQUIRE(bus.find_and_count_devices_on_bus() == 3);
+	for (int i = 0; i < 3; i++) {
+		REQUIRE(bus.set_alarm_thresholds(bus.get_address(i), 30, 0));
+	}
+	rom_address_t address{};
+	bus.convert_temperature(address, true, true);
+
+	rom_address_t alarmed[3];
+	REQUIRE(bus.find_alarmed_devices(alarmed, 3) == 2);
+	uint64_t first = One_wire::to_uint64(alarmed[0]);
+	uint64_t second = One_wire::to_uint64(alarmed[1]);
+	REQUIRE(first != second);
+	REQUIRE((first == cold.id() || first == hot.id()));
+	REQUIRE((second == cold.id() || second == hot.id()));
+	sim.detach();
+}
+
+TEST_CASE("SimulatedParasitePower", "[one_wire_sim]") {
+	Sim_thermometer device(FAMILY_CODE_DS18B20, 9, true);
+	device.set_temperature(-625);
+	One_wire_sim sim;
+	sim.add(device);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	REQUIRE(bus.find_and_count_devices_on_bus() == 1);
+	rom_address_t address = device.rom();
+	REQUIRE(bus.read_device_config(address));
+	REQUIRE(bus.find_device(address)->parasite_powered);
+	REQUIRE(bus.convert_temperature(address, false, false) == 0);// held on the strong pull up
+	REQUIRE(bus.temperature(address) == -0.625f);
+	sim.detach();
+}
+
+TEST_CASE("BusStats", "[one_wire_stats]") {
+	Sim_thermometer first(FAMILY_CODE_DS18B20, 10);
+	Sim_thermometer second(FAMILY_CODE_DS18B20, 11);
+	Sim_thermometer third(FAMILY_CODE_DS18S20, 12);
+	One_wire_sim sim;
+	sim.add(first);
+	sim.add(second);
+	sim.add(third);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	const bus_stats_t &stats = bus.stats();
+	REQUIRE(stats.resets == 0);
+
+	REQUIRE(bus.find_and_count_devices_on_bus() == 3);
+	REQUIRE(stats.search_passes == 3);
+	REQUIRE(stats.resets == 3);
+	REQUIRE(stats.presence_failures == 0);
+	// a command byte, then two reads and a write for each ROM bit
+	REQUIRE(stats.bits_written == 3 * (8 + 64));
+	REQUIRE(stats.bits_read == 3 * 128);
+	const bus_operation_stats_t &search = stats.operations[(size_t) bus_operation_t::search];
+	REQUIRE(search.reset_us >= 3 * 960);
+	REQUIRE(search.slot_us >= 3 * (8 + 192) * 50);
+	REQUIRE(search.wait_us == 0);
+
+	rom_address_t address{};
+	bus.convert_temperature(address, true, true);
+	const bus_operation_stats_t &convert = stats.operations[(size_t) bus_operation_t::convert];
+	REQUIRE(convert.wait_us == 750000);
+	REQUIRE(convert.reset_us > 0);
+
+	address = first.rom();
+	REQUIRE(bus.set_alarm_thresholds(address, 50, -10, true));
+	REQUIRE(stats.operations[(size_t) bus_operation_t::write_scratch_pad].wait_us == 10000);
+	const bus_operation_stats_t &read = stats.operations[(size_t) bus_operation_t::read_scratch_pad];
+	uint64_t read_slots = read.slot_us;
+	REQUIRE(read_slots >= (9 * 8 + 72) * 50);// the configuration read
+	REQUIRE(bus.temperature(address) == 25.0f);
+	REQUIRE(read.slot_us >= read_slots + (9 * 8 + 72) * 50);
+
+	sim.clear();
+	REQUIRE(bus.temperature(address) == (float) One_wire::invalid_conversion);
+	REQUIRE(stats.presence_failures == 1);
+	REQUIRE(stats.crc_failures == 0);
+
+	bus.clear_stats();
+	REQUIRE(stats.resets == 0);
+	REQUIRE(stats.operations[(size_t) bus_operation_t::convert].wait_us == 0);
+	sim.detach();
+}
+
+TEST_CASE("RetryPolicy", "[one_wire]") {
+	Sim_thermometer first(FAMILY_CODE_DS18B20, 13);
+	Sim_thermometer second(FAMILY_CODE_DS18B20, 14);
+	first.set_temperature(25000);
+	second.set_temperature(26000);
+	One_wire_sim sim;
+	sim.add(first);
+	sim.add(second);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	REQUIRE(bus.find_and_count_devices_on_bus() == 2);
+	rom_address_t address{};
+	bus.convert_temperature(address, true, true);
+	address = first.rom();
+	device_info_t *device = bus.find_device(address);
+	// Match ROM and Read Scratch Pad are 80 write slots, then byte 5 of the scratch pad (0xFF)
+	const uint64_t reserved_byte_slot = 80 + 5 * 8;
+	float temperature = 0;
+
+	SECTION("no retries") {
+		sim.glitch(sim.slots + reserved_byte_slot);
+		REQUIRE(bus.read_temperature(address, temperature) == one_wire_status_t::crc_error);
+		REQUIRE(temperature == 0);
+		REQUIRE(device->crc_errors == 1);
+		REQUIRE(bus.temperature(address) == 25.0f);
+	}
+	SECTION("only the failed read is repeated") {
+		bus.set_retry_policy(2, 100);
+		Bus_readings<2> readings;
+		sim.glitch(sim.slots + 16 + reserved_byte_slot);// after the Skip ROM, Convert T
+		uint64_t resets = sim.resets;
+		REQUIRE(bus.read_all(readings) == 2);
+		REQUIRE(readings.crc_ok[0]);
+		REQUIRE(readings.crc_ok[1]);
+		for (int i = 0; i < 2; i++) {
+			REQUIRE(readings.raw[i] == (readings.ids[i] == first.id() ? 25 * 16 : 26 * 16));
+		}
+		REQUIRE(sim.resets - resets == 4);// convert, the first device twice, the second
+		REQUIRE(first.conversions == 2);
+		REQUIRE(bus.find_device(bus.get_address(0))->crc_errors == 1);
+		REQUIRE(bus.find_device(bus.get_address(1))->crc_errors == 0);
+	}
+	SECTION("no presence") {
+		bus.set_retry_policy(1);
+		sim.clear();
+		REQUIRE(bus.read_temperature(address, temperature) == one_wire_status_t::no_presence);
+		REQUIRE(device->presence_errors == 2);
+		REQUIRE(device->crc_errors == 0);
+	}
+	SECTION("unsupported device") {
+		rom_address_t memory = Sim_device::make_rom(FAMILY_CODE_DS2502, 1);
+		uint64_t slots = sim.slots;
+		REQUIRE(bus.read_temperature(memory, temperature) == one_wire_status_t::unsupported_device);
+		REQUIRE(sim.slots == slots);
+	}
+	sim.detach();
+}
+
+TEST_CASE("ReadROMChecked", "[one_wire]") {
+	Sim_thermometer device(FAMILY_CODE_DS18B20, 15);
+	One_wire_sim sim;
+	sim.add(device);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	rom_address_t address{};
+	REQUIRE(bus.single_device_read_rom(address) == one_wire_status_t::ok);
+	REQUIRE(One_wire::to_uint64(address) == device.id());
+
+	rom_address_t unchanged{};
+	sim.glitch(sim.slots + 8 + 60);// a 1 in the CRC byte
+	REQUIRE(bus.single_device_read_rom(unchanged) == one_wire_status_t::crc_error);
+	REQUIRE(unchanged.rom[0] == 0);
+
+	sim.clear();
+	REQUIRE(bus.single_device_read_rom(unchanged) == one_wire_status_t::no_presence);
+	sim.detach();
+}
+
+TEST_CASE("FixedPointTemperature", "[one_wire]") {
+	SECTION("DS18S20 extended resolution matches the datasheet formula") {
+		uint8_t scratch_pad[ScratchPadSize]{};
+		scratch_pad[7] = 0x10;
+		for (int raw = -110; raw <= 250; raw++) {
+			for (int count_remain = 0; count_remain <= 16; count_remain++) {
+				scratch_pad[0] = (uint8_t) raw;
+				scratch_pad[1] = (uint8_t) (raw >> 8);
+				scratch_pad[6] = (uint8_t) count_remain;
+				double expected = std::floor(raw / 2.0) - 0.25 + (16 - count_remain) / 16.0;
+				REQUIRE(One_wire::scratch_pad_to_fixed(FAMILY_CODE_DS18S20, scratch_pad) == (int32_t) (expected * 16));
+			}
+		}
+	}
+	SECTION("conversions") {
+		REQUIRE(One_wire::fixed_to_fahrenheit(100 * 16) == 212 * 16);
+		REQUIRE(One_wire::fixed_to_fahrenheit(-40 * 16) == -40 * 16);
+		REQUIRE(One_wire::fixed_to_fahrenheit(1) == 32 * 16 + 2);// 1.8/16 rounds to 2/16
+		REQUIRE(One_wire::fixed_to_fahrenheit(-1) == 32 * 16 - 2);
+		REQUIRE(One_wire::fixed_to_milli(-162) == -10125);
+		REQUIRE(One_wire::fixed_to_milli(1) == 63);
+		REQUIRE(One_wire::fixed_to_milli(-1) == -63);
+	}
+	SECTION("read from each family") {
+		Sim_thermometer ds18b20(FAMILY_CODE_DS18B20, 16);
+		Sim_thermometer ds18s20(FAMILY_CODE_DS18S20, 17);
+		ds18b20.set_temperature(-10125);
+		ds18s20.set_temperature(85500);
+		One_wire_sim sim;
+		sim.add(ds18b20);
+		sim.add(ds18s20);
+		sim.attach(2);
+		One_wire bus(2);
+		bus.init();
+		rom_address_t address{};
+		bus.convert_temperature(address, true, true);
+
+		int32_t sixteenths = 0;
+		address = ds18b20.rom();
+		REQUIRE(bus.read_temperature_fixed(address, sixteenths) == one_wire_status_t::ok);
+		REQUIRE(sixteenths == -162);
+		REQUIRE(bus.read_temperature_fixed(address, sixteenths, true) == one_wire_status_t::ok);
+		REQUIRE(sixteenths == 220);// 13.775 degF to the nearest 1/16
+		address = ds18s20.rom();
+		REQUIRE(bus.read_temperature_fixed(address, sixteenths) == one_wire_status_t::ok);
+		REQUIRE(sixteenths == 85 * 16 + 8);
+		REQUIRE(bus.temperature(address) == 85.5f);
+		sim.detach();
+	}
+}
+
+static void check_staggered_conversions(bool parasite) {
+	std::vector<Sim_thermometer> devices;
+	for (int i = 0; i < 6; i++) {
+		devices.emplace_back(FAMILY_CODE_DS18B20, 20 + i, parasite);
+		devices.back().set_temperature(20000 + i * 1000);
+	}
+	One_wire_sim sim;
+	for (Sim_thermometer &device : devices) {
+		sim.add(device);
+	}
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	REQUIRE(bus.find_and_count_devices_on_bus() == 6);
+	// two slow devices, four fast
+	for (int i = 0; i < 6; i++) {
+		REQUIRE(bus.set_resolution(bus.get_address(i), i < 2 ? 12 : 9));
+		REQUIRE(bus.read_device_config(bus.get_address(i)));
+	}
+	Bus_readings<8> readings;
+
+	uint64_t started = mockTimeUs;
+	REQUIRE(bus.read_all(readings) == 6);
+	uint64_t skip_rom_time = mockTimeUs - started;
+
+	started = mockTimeUs;
+	uint64_t resets = sim.resets;
+	REQUIRE(bus.read_all_staggered(readings) == 6);
+	uint64_t staggered_time = mockTimeUs - started;
+	REQUIRE(sim.resets - resets == 1 + 6);// one conversion for both groups, the configs were cached
+	for (int i = 0; i < 6; i++) {
+		REQUIRE(readings.crc_ok[i]);
+		rom_address_t address = bus.get_address(i);
+		REQUIRE(readings.ids[i] == One_wire::to_uint64(address));
+		for (Sim_thermometer &device : devices) {
+			if (device.id() == readings.ids[i]) {
+				REQUIRE(readings.raw[i] == (20 + (&device - &devices[0])) * 16);
+			}
+		}
+	}
+
+	if (parasite) {
+		// one Skip ROM conversion under the pull up, only as long as the slowest device needs
+		REQUIRE(staggered_time >= 750000);
+		REQUIRE(staggered_time <= skip_rom_time);
+	} else {
+		// the fast devices were read while the slow ones converted
+		for (int i = 2; i < 6; i++) {
+			REQUIRE(readings.timestamps[i] < started + 750000);
+		}
+		REQUIRE(staggered_time < skip_rom_time - 20000);
+		REQUIRE(staggered_time < 750000 + 3 * 12000);// the slow conversion, then two reads
+		for (Sim_thermometer &device : devices) {
+			REQUIRE(device.conversions == 2);
+		}
+	}
+	sim.detach();
+}
+
+TEST_CASE("StaggeredConversions", "[one_wire]") {
+	SECTION("externally powered") {
+		check_staggered_conversions(false);
+	}
+	SECTION("parasite powered") {
+		check_staggered_conversions(true);
+	}
+}
+
+template<typename Bus>
+static void check_fixed_bus(Bus &bus, Sim_thermometer &device, One_wire_sim &sim) {
+	bus.init();
+	rom_address_t address{};
+	REQUIRE(bus.read_rom(address) == one_wire_status_t::ok);
+	REQUIRE(One_wire::to_uint64(address) == device.id());
+
+	REQUIRE(bus.skip_rom());
+	bus.byte_out(ConvertTempCommand);
+	bus.strong_pullup(true);
+	sleep_ms(750);
+	bus.strong_pullup(false);
+	REQUIRE(device.conversions == 1);
+
+	uint8_t scratch_pad[ScratchPadSize];
+	uint64_t resets = sim.resets;
+	REQUIRE(bus.read_scratch_pad(address, scratch_pad) == one_wire_status_t::ok);
+	REQUIRE(sim.resets == resets + 1);
+	REQUIRE(One_wire::scratch_pad_to_fixed(address.rom[0], scratch_pad) == 23 * 16 + 8);
+
+	sim.glitch(sim.slots + 8 + 64 + 8 + 3);// a 1 in the first temperature byte
+	REQUIRE(bus.read_scratch_pad(address, scratch_pad) == one_wire_status_t::crc_error);
+}
+
+TEST_CASE("FixedPinBus", "[one_wire_sim]") {
+	Sim_thermometer device(FAMILY_CODE_DS18B20, 7, true);
+	device.set_temperature(23500);
+	One_wire_sim sim;
+	sim.add(device);
+	sim.attach(2);
+
+	SECTION("standard timing") {
+		One_wire_fixed<2> bus;
+		check_fixed_bus(bus, device, sim);
+	}
+	SECTION("long line timing") {
+		One_wire_fixed<2, One_wire::not_controllable, Long_line_timing_profile> bus;
+		check_fixed_bus(bus, device, sim);
+	}
+	SECTION("power pin") {
+		One_wire_fixed<2, 3> bus;
+		bus.init();
+		REQUIRE(mockOutputHigh(3));// off, the MOSFET is active low
+		bus.strong_pullup(true);
+		REQUIRE_FALSE(mockOutputHigh(3));
+		bus.strong_pullup(false);
+		REQUIRE(mockOutputHigh(3));
+	}
+	SECTION("no devices") {
+		sim.clear();
+		One_wire_fixed<2> bus;
+		bus.init();
+		rom_address_t address{};
+		REQUIRE(!bus.reset());
+		REQUIRE(bus.read_rom(address) == one_wire_status_t::no_presence);
+	}
+	sim.detach();
+
+	// the run time bus shares the profiles
+	REQUIRE(One_wire::standard_timing.write_0_low == Standard_timing_profile::timing.write_0_low);
+	REQUIRE(One_wire::overdrive_timing.reset_low == Overdrive_timing_profile::timing.reset_low);
+}
+
+TEST_CASE("JitterTolerantSlots", "[one_wire_sim]") {
+	Sim_thermometer device(FAMILY_CODE_DS18B20, 9);
+	device.set_temperature(-12625);
+	One_wire_sim sim;
+	sim.add(device);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	REQUIRE(bus.find_and_count_devices_on_bus() == 1);
+	rom_address_t address = device.rom();
+	bus.convert_temperature(address, true, false);
+
+	uint64_t started = mockTimeUs;
+	REQUIRE(bus.temperature(address) == -12.625f);
+	uint64_t quiet_time = mockTimeUs - started;
+
+	SECTION("maskable interrupts wait for the strict part of each slot") {
+		mockInterrupts(4, 12);
+		started = mockTimeUs;
+		for (int i = 0; i < 20; i++) {
+			REQUIRE(bus.temperature(address) == -12.625f);
+		}
+		mockInterrupts(0, 0);
+		REQUIRE(mockTimeUs - started > 20 * quiet_time);// the interrupts did land in the slots
+		REQUIRE(bus.slot_overruns() == 0);
+		REQUIRE(bus.stats().crc_failures == 0);
+	}
+	SECTION("an interrupt longer than a 0 less a 1 never turns a 0 into a 1") {
+		// 50us is more than write_0_low less the longest 1 (60 - 15), so one taken between
+		// the timestamp and the falling edge of a 0 would leave it short enough to read as 1
+		mockTimerReadInterrupts(7, 50);
+		for (int i = 0; i < 20; i++) {
+			REQUIRE(bus.temperature(address) == -12.625f);
+		}
+		mockTimerReadInterrupts(0, 0);
+		REQUIRE(sim.shortest_reset_low >= 480);
+		REQUIRE(bus.stats().crc_failures == 0);
+	}
+	SECTION("interrupts are only masked for the strict part of a reset") {
+		mockLongestMaskedUs = 0;
+		REQUIRE(bus.reset());
+		REQUIRE(mockLongestMaskedUs < 15);// not the 70us from release to the presence sample
+	}
+	SECTION("unmaskable interrupts are seen as overruns") {
+		mockInterrupts(4, 12, true);
+		for (int i = 0; i < 20; i++) {
+			bus.temperature(address);
+		}
+		mockInterrupts(0, 0);
+		REQUIRE(bus.slot_overruns() > 0);
+	}
+	sim.detach();
+}
+
+static void check_transactions(One_wire_base &bus, Sim_thermometer &device) {
+	rom_address_t address{};
+	REQUIRE(bus.reset());
+	bus.write_byte(ReadROMCommand);
+	bus.read(address.rom, ROMSize);
+	REQUIRE(One_wire::to_uint64(address) == device.id());
+
+	const uint8_t convert[] = {ConvertTempCommand};
+	REQUIRE(bus.transaction(nullptr, convert, sizeof(convert)) == one_wire_status_t::ok);
+	sleep_ms(750);
+	REQUIRE(device.conversions == 1);
+
+	const uint8_t read_scratch_pad[] = {ReadScratchPadCommand};
+	uint8_t scratch_pad[ScratchPadSize];
+	uint64_t bits_read = bus.stats().bits_read;
+	REQUIRE(bus.transaction(&address, read_scratch_pad, sizeof(read_scratch_pad), scratch_pad, ScratchPadSize) ==
+			one_wire_status_t::ok);
+	REQUIRE(bus.stats().bits_read == bits_read + ScratchPadSize * 8);
+	REQUIRE(memcmp(scratch_pad, device.scratch_pad(), ScratchPadSize) == 0);
+	REQUIRE(One_wire::scratch_pad_to_fixed(address.rom[0], scratch_pad) == 31 * 16 + 4);
+
+	// the same, a step at a time, stopping after the temperature
+	REQUIRE(bus.select(address));
+	bus.write_byte(ReadScratchPadCommand);
+	REQUIRE(bus.read_byte() == scratch_pad[0]);
+	REQUIRE(bus.read_bit() == ((scratch_pad[1] & 0x01) != 0));
+}
+
+TEST_CASE("TransactionApi", "[one_wire_sim]") {
+	Sim_thermometer device(FAMILY_CODE_DS18B20, 11);
+	device.set_temperature(31250);
+	One_wire_sim sim;
+	sim.add(device);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+
+	SECTION("bit-banged") {
+		check_transactions(bus, device);
+	}
+	SECTION("pio") {
+		REQUIRE(bus.use_pio(pio0));
+		check_transactions(bus, device);
+	}
+	SECTION("no devices") {
+		sim.clear();
+		const uint8_t convert[] = {ConvertTempCommand};
+		REQUIRE(!bus.reset());
+		REQUIRE(!bus.select_all());
+		REQUIRE(bus.transaction(nullptr, convert, sizeof(convert)) == one_wire_status_t::no_presence);
+	}
+	sim.detach();
+}
+
+TEST_CASE("MemoryDevices", "[one_wire_sim]") {
+	Sim_ds2502 eprom(1);
+	Sim_max31826 eeprom(2);
+	Sim_thermometer ds18b20(FAMILY_CODE_DS18B20, 3);
+	for (size_t i = 0; i < Sim_ds2502::memory_size; i++) {
+		eprom.memory[i] = (uint8_t) (i * 7 + 1);
+	}
+	One_wire_sim sim;
+	sim.add(eprom);
+	sim.add(eeprom);
+	sim.add(ds18b20);
+	sim.attach(2);
+	One_wire bus(2);
+	bus.init();
+	One_wire_memory memory(bus);
+	uint8_t data[One_wire_memory::memory_size];
+
+	SECTION("DS2502 reads are streamed and checked") {
+		rom_address_t address = eprom.rom();
+		uint32_t commands = eprom.function_commands;
+		REQUIRE(memory.read(address, 0, data, sizeof(data)) == one_wire_status_t::ok);
+		REQUIRE(eprom.function_commands == commands + 1);// one transaction for every page
+		REQUIRE(memcmp(data, eprom.memory, sizeof(data)) == 0);
+
+		REQUIRE(memory.read(address, 20, data, 30) == one_wire_status_t::ok);
+		REQUIRE(memcmp(data, &eprom.memory[20], 30) == 0);
+
+		sim.glitch(sim.slots + 72 + 24 + 8);// a 1 in the first byte of data
+		REQUIRE(memory.read(address, 0, data, 8) == one_wire_status_t::crc_error);
+
+		REQUIRE(memory.read(address, 100, data, 29) == one_wire_status_t::unsupported_device);
+		REQUIRE(memory.write(address, 0, data, 1) == one_wire_status_t::unsupported_device);
+	}
+	SECTION("pages are cached") {
+		rom_address_t address = eprom.rom();
+		uint32_t commands = eprom.function_commands;
+		REQUIRE(memory.read_page(address, 1, data) == one_wire_status_t::ok);
+		REQUIRE(memory.read_page(address, 1, data) == one_wire_status_t::ok);
+		REQUIRE(eprom.function_commands == commands + 1);
+		REQUIRE(memory.cache_hits() == 1);
+		REQUIRE(memcmp(data, &eprom.memory[32], One_wire_memory::page_size) == 0);
+		memory.invalidate();
+		REQUIRE(memory.read_page(address, 1, data) == one_wire_status_t::ok);
+		REQUIRE(eprom.function_commands == commands + 2);
+		REQUIRE(memory.read_page(address, 4, data) == one_wire_status_t::unsupported_device);
+	}
+	SECTION("MAX31826 writes go through scratch pad 2") {
+		rom_address_t address = eeprom.rom();
+		REQUIRE(memory.read_page(address, 0, data) == one_wire_status_t::ok);
+		REQUIRE(data[10] == 0xFF);
+
+		uint8_t table[20];
+		for (size_t i = 0; i < sizeof(table); i++) {
+			table[i] = (uint8_t) (0x40 + i);
+		}
+		REQUIRE(memory.write(address, 5, table, sizeof(table)) == one_wire_status_t::ok);
+		REQUIRE(eeprom.copies == 4);// blocks 0 to 3
+		REQUIRE(eeprom.memory[4] == 0xFF);
+		REQUIRE(memcmp(&eeprom.memory[5], table, sizeof(table)) == 0);
+		REQUIRE(eeprom.memory[25] == 0xFF);
+
+		uint32_t reads = eeprom.memory_reads;
+		REQUIRE(memory.read_page(address, 0, data) == one_wire_status_t::ok);// written, so read again
+		REQUIRE(eeprom.memory_reads == reads + 2);
+		REQUIRE(memcmp(&data[5], table, sizeof(table)) == 0);
+
+		sim.glitch(sim.slots + 72 + 16 + 6);// a 1 (of 0x40) in the first read only
+		REQUIRE(memory.read(address, 5, data, 8) == one_wire_status_t::crc_error);
+
+		// still a thermometer
+		eeprom.set_temperature(40500);
+		bus.convert_temperature(address, true, false);
+		REQUIRE(bus.temperature(address) == 40.5f);
+	}
+	SECTION("other families") {
+		rom_address_t address = ds18b20.rom();
+		REQUIRE(!One_wire_memory::supported(FAMILY_CODE_DS18B20));
+		REQUIRE(memory.read(address, 0, data, 8) == one_wire_status_t::unsupported_device);
+		REQUIRE(memory.write(address, 0, data, 8) == one_wire_status_t::unsupported_device);
+	}
+	sim.detach();
+}